@@ -1,9 +1,13 @@
 #ifndef AVLTREE_H
 #define AVLTREE_H
 
+#include <algorithm>
+#include <cstddef>
 #include <iostream>
+#include <iterator>
 #include <stdexcept>
 #include <sstream>
+#include <vector>
 using namespace std;
 
 template <typename T>
@@ -12,9 +16,10 @@ private:
     struct Node {
         T data;
         int height;
+        size_t count; // Nodes in this subtree, including this one
         Node* left;
         Node* right;
-        Node(const T& val) : data(val), height(1), left(nullptr), right(nullptr) {}
+        Node(const T& val) : data(val), height(1), count(1), left(nullptr), right(nullptr) {}
     };
 
     Node* root;
@@ -23,6 +28,14 @@ private:
 
     int balanceFactor(Node* node) const { return node ? height(node->left) - height(node->right) : 0; }
 
+    size_t count(Node* node) const { return node ? node->count : 0; }
+
+    // Recompute height and subtree count from the children
+    void update(Node* node) {
+        node->height = max(height(node->left), height(node->right)) + 1;
+        node->count = count(node->left) + count(node->right) + 1;
+    }
+
     Node* rotateRight(Node* y) {
         Node* x = y->left;
         Node* T2 = x->right;
@@ -30,8 +43,8 @@ private:
         x->right = y;
         y->left = T2;
 
-        y->height = max(height(y->left), height(y->right)) + 1;
-        x->height = max(height(x->left), height(x->right)) + 1;
+        update(y);
+        update(x);
 
         return x;
     }
@@ -43,8 +56,8 @@ private:
         y->left = x;
         x->right = T2;
 
-        x->height = max(height(x->left), height(x->right)) + 1;
-        y->height = max(height(y->left), height(y->right)) + 1;
+        update(x);
+        update(y);
 
         return y;
     }
@@ -60,7 +73,7 @@ private:
             return node; // Duplicates not allowed
         }
 
-        node->height = 1 + max(height(node->left), height(node->right));
+        update(node);
 
         int balance = balanceFactor(node);
 
@@ -106,8 +119,8 @@ private:
 
         if (!node) return nullptr;
 
-        // Update height and balance the tree
-        node->height = 1 + max(height(node->left), height(node->right));
+        // Update height and count, then balance the tree
+        update(node);
         int balance = balanceFactor(node);
 
         // Left Left Case
@@ -135,6 +148,17 @@ private:
         return node;
     }
 
+    // Balanced subtree over values[lo, hi) with heights filled in; no rotations needed
+    Node* buildBalanced(const vector<T>& values, size_t lo, size_t hi) {
+        if (lo >= hi) return nullptr;
+        size_t mid = lo + (hi - lo) / 2;
+        Node* node = new Node(values[mid]);
+        node->left = buildBalanced(values, lo, mid);
+        node->right = buildBalanced(values, mid + 1, hi);
+        update(node);
+        return node;
+    }
+
     Node* findMinNode(Node* node) const {
         while (node && node->left) {
             node = node->left;
@@ -142,13 +166,6 @@ private:
         return node;
     }
 
-    void inorder(Node* node, ostringstream& oss) const {
-        if (!node) return;
-        inorder(node->left, oss);
-        oss << node->data << " ";
-        inorder(node->right, oss);
-    }
-
     T findMax(Node* node) const {
         if (!node) throw runtime_error("Tree is empty.");
         while (node->right) {
@@ -172,10 +189,10 @@ private:
         delete node;
     }
 
-    size_t size(Node* node) const {
-        if (!node) return 0;
-        return 1 + size(node->left) + size(node->right);
-    }
+    // Leftmost node satisfying goesLeft (which must be monotone in the value), or end().
+    // The descent path is kept and cut back to that node, which is exactly its iterator stack.
+    template <typename Predicate>
+    typename AVLTree::const_iterator bound(Predicate goesLeft) const;
 
     bool isBalanced(Node* node) const {
         if (!node) return true;
@@ -184,25 +201,172 @@ private:
     }
 
 public:
+    // In-order iterator over the values. It keeps the path from the root to the current node on
+    // a stack instead of using parent pointers, so stepping either way is amortised O(1) with no
+    // recursion. Any insert or remove invalidates every iterator.
+    class const_iterator {
+    private:
+        friend class AVLTree;
+        const AVLTree* tree;
+        vector<Node*> path; // Root first; empty means end()
+
+        const_iterator(const AVLTree* owner) : tree(owner) {}
+
+        void pushLeftSpine(Node* node) {
+            for (; node; node = node->left) path.push_back(node);
+        }
+
+        void pushRightSpine(Node* node) {
+            for (; node; node = node->right) path.push_back(node);
+        }
+
+    public:
+        using iterator_category = bidirectional_iterator_tag;
+        using value_type = T;
+        using difference_type = ptrdiff_t;
+        using pointer = const T*;
+        using reference = const T&;
+
+        const T& operator*() const { return path.back()->data; }
+        const T* operator->() const { return &path.back()->data; }
+
+        const_iterator& operator++() {
+            Node* node = path.back();
+            if (node->right) {
+                pushLeftSpine(node->right);
+                return *this;
+            }
+            // Climb until we leave a left subtree; that ancestor is next
+            path.pop_back();
+            while (!path.empty() && path.back()->right == node) {
+                node = path.back();
+                path.pop_back();
+            }
+            return *this;
+        }
+
+        // Decrementing end() moves to the largest value
+        const_iterator& operator--() {
+            if (path.empty()) {
+                pushRightSpine(tree->root);
+                return *this;
+            }
+            Node* node = path.back();
+            if (node->left) {
+                pushRightSpine(node->left);
+                return *this;
+            }
+            path.pop_back();
+            while (!path.empty() && path.back()->left == node) {
+                node = path.back();
+                path.pop_back();
+            }
+            return *this;
+        }
+
+        bool operator==(const const_iterator& other) const {
+            return path.empty() ? other.path.empty() : !other.path.empty() && path.back() == other.path.back();
+        }
+
+        bool operator!=(const const_iterator& other) const { return !(*this == other); }
+    };
+
+    const_iterator begin() const {
+        const_iterator it(this);
+        it.pushLeftSpine(root);
+        return it;
+    }
+
+    const_iterator end() const { return const_iterator(this); }
+
+    // First value >= value, or end()
+    const_iterator lowerBound(const T& value) const {
+        return bound([&value](const T& data) { return !(data < value); });
+    }
+
+    // First value > value, or end()
+    const_iterator upperBound(const T& value) const {
+        return bound([&value](const T& data) { return value < data; });
+    }
+
     AVLTree() : root(nullptr) {}
 
     ~AVLTree() { clear(root); }
 
     void insert(const T& value) { root = insert(root, value); }
 
+    // Replace the contents with ascending values in O(n). Duplicates are dropped, as insert would.
+    void buildFromSorted(const vector<T>& values) {
+        if (!is_sorted(values.begin(), values.end())) throw invalid_argument("Values must be sorted.");
+        clear();
+        if (adjacent_find(values.begin(), values.end()) == values.end()) {
+            root = buildBalanced(values, 0, values.size());
+            return;
+        }
+        vector<T> unique(values);
+        unique.erase(std::unique(unique.begin(), unique.end()), unique.end());
+        root = buildBalanced(unique, 0, unique.size());
+    }
+
     void remove(const T& value) { root = remove(root, value); }
 
     string inorderAsString() const {
         ostringstream oss;
-        inorder(root, oss);
+        for (const T& value : *this) oss << value << " ";
         return oss.str();
     }
 
+    // Values in ascending order
+    vector<T> toVector() const {
+        vector<T> values;
+        values.reserve(size());
+        for (const T& value : *this) values.push_back(value);
+        return values;
+    }
+
     T findMax() const { return findMax(root); }
 
     T findMin() const { return findMin(root); }
 
-    size_t size() const { return size(root); }
+    size_t size() const { return count(root); }
+
+    // The k-th smallest value, counting from 0
+    T select(size_t k) const {
+        if (k >= count(root)) throw out_of_range("Index out of range.");
+        Node* node = root;
+        while (true) {
+            size_t leftCount = count(node->left);
+            if (k < leftCount) {
+                node = node->left;
+            } else if (k == leftCount) {
+                return node->data;
+            } else {
+                k -= leftCount + 1;
+                node = node->right;
+            }
+        }
+    }
+
+    // How many stored values are smaller than value
+    size_t rank(const T& value) const {
+        size_t smaller = 0;
+        Node* node = root;
+        while (node) {
+            if (value <= node->data) {
+                node = node->left;
+            } else {
+                smaller += count(node->left) + 1;
+                node = node->right;
+            }
+        }
+        return smaller;
+    }
+
+    bool contains(const T& value) const {
+        Node* node = root;
+        while (node && node->data != value) node = value < node->data ? node->left : node->right;
+        return node != nullptr;
+    }
 
     bool isEmpty() const { return root == nullptr; }
 
@@ -216,4 +380,22 @@ public:
     }
 };
 
+template <typename T>
+template <typename Predicate>
+typename AVLTree<T>::const_iterator AVLTree<T>::bound(Predicate goesLeft) const {
+    const_iterator it(this);
+    size_t found = 0; // Path length up to the best node so far; 0 means none yet
+    for (Node* node = root; node;) {
+        it.path.push_back(node);
+        if (goesLeft(node->data)) {
+            found = it.path.size();
+            node = node->left;
+        } else {
+            node = node->right;
+        }
+    }
+    it.path.resize(found);
+    return it;
+}
+
 #endif // AVLTREE_H
\ No newline at end of file
@@ -0,0 +1,637 @@
+#ifndef BPLUSTREE_H
+#define BPLUSTREE_H
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <iostream>
+#include <iterator>
+#include <sstream>
+#include <stdexcept>
+#include <type_traits>
+#include <vector>
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+using namespace std;
+
+// Ordered set (or multiset) stored as a B+tree. Each node keeps its keys in one contiguous
+// NodeBytes array (256 bytes = 64 ints = 4 cache lines), so a search touches a handful of
+// lines per level instead of one node allocation per value, and int keys are ranked within a
+// node with SSE2 compares. Leaves are chained for ordered iteration. Inner nodes keep the value
+// count under each child, which gives O(log n) select/rank like the AVLTree order statistics.
+//
+// With allowDuplicates, equal values are kept as one key with a multiplicity, matching
+// BinaryTree; without it, repeated inserts are ignored, matching AVLTree.
+template <typename T, size_t NodeBytes = 256>
+class BPlusTree {
+private:
+    static const size_t KEYS = NodeBytes / sizeof(T) < 4 ? 4 : NodeBytes / sizeof(T) / 2 * 2;
+    static const size_t MIN_KEYS = KEYS / 2; // Every node but the root stays at least half full
+
+    struct Node {
+        bool leaf;
+        uint16_t count; // Keys in use
+        size_t total;   // Values stored in this subtree, counting multiplicity
+        Node(bool isLeaf) : leaf(isLeaf), count(0), total(0) {}
+    };
+
+    struct Leaf : Node {
+        alignas(64) T keys[KEYS];
+        uint32_t multiplicity[KEYS];
+        Leaf* prev;
+        Leaf* next;
+        Leaf() : Node(true), prev(nullptr), next(nullptr) {}
+    };
+
+    // children[i] holds values in [keys[i - 1], keys[i])
+    struct Inner : Node {
+        alignas(64) T keys[KEYS];
+        Node* children[KEYS + 1];
+        size_t counts[KEYS + 1]; // counts[i] == children[i]->total
+        Inner() : Node(false) {}
+    };
+
+    Node* root;
+    Leaf* head; // Leftmost leaf; never freed while the tree is alive
+    Leaf* tail;
+    int levels;
+    bool duplicates;
+
+    // Number of keys[0, n) below value, or at or below it when inclusive. Keys are sorted,
+    // so this is the lower (upper) bound position.
+    static size_t rankInNode(const T* keys, size_t n, const T& value, bool inclusive) {
+#ifdef __SSE2__
+        if constexpr (is_same<T, int32_t>::value) {
+            __m128i needle = _mm_set1_epi32(value);
+            size_t below = 0;
+            size_t i = 0;
+            for (; i + 4 <= n; i += 4) {
+                __m128i block = _mm_loadu_si128(reinterpret_cast<const __m128i*>(keys + i));
+                // inclusive: key <= value is !(key > value); otherwise key < value
+                __m128i hit = inclusive ? _mm_cmpgt_epi32(block, needle) : _mm_cmpgt_epi32(needle, block);
+                int mask = _mm_movemask_ps(_mm_castsi128_ps(hit));
+                below += inclusive ? 4 - __builtin_popcount(mask) : __builtin_popcount(mask);
+            }
+            for (; i < n; ++i) below += inclusive ? !(value < keys[i]) : keys[i] < value;
+            return below;
+        }
+#endif
+        return (inclusive ? upper_bound(keys, keys + n, value) : lower_bound(keys, keys + n, value)) - keys;
+    }
+
+    // Child index for value: equal keys live right of their separator
+    static size_t route(const Inner* inner, const T& value) {
+        return rankInNode(inner->keys, inner->count, value, true);
+    }
+
+    Leaf* findLeaf(const T& value) const {
+        Node* node = root;
+        while (!node->leaf) {
+            const Inner* inner = static_cast<const Inner*>(node);
+            node = inner->children[route(inner, value)];
+        }
+        return static_cast<Leaf*>(node);
+    }
+
+    /// Insertion
+
+    struct Split {
+        Node* right = nullptr;
+        T separator;
+    };
+
+    static void insertIntoLeaf(Leaf* leaf, size_t pos, const T& value) {
+        move_backward(leaf->keys + pos, leaf->keys + leaf->count, leaf->keys + leaf->count + 1);
+        move_backward(leaf->multiplicity + pos, leaf->multiplicity + leaf->count, leaf->multiplicity + leaf->count + 1);
+        leaf->keys[pos] = value;
+        leaf->multiplicity[pos] = 1;
+        ++leaf->count;
+        ++leaf->total;
+    }
+
+    static size_t sumMultiplicity(const Leaf* leaf, size_t from, size_t to) {
+        size_t total = 0;
+        for (size_t i = from; i < to; ++i) total += leaf->multiplicity[i];
+        return total;
+    }
+
+    bool insertInto(Node* node, const T& value, Split& split) {
+        if (node->leaf) {
+            Leaf* leaf = static_cast<Leaf*>(node);
+            size_t pos = rankInNode(leaf->keys, leaf->count, value, false);
+            if (pos < leaf->count && !(value < leaf->keys[pos])) {
+                if (!duplicates) return false;
+                ++leaf->multiplicity[pos];
+                ++leaf->total;
+                return true;
+            }
+            if (leaf->count < KEYS) {
+                insertIntoLeaf(leaf, pos, value);
+                return true;
+            }
+
+            // Full: move the upper half to a new right sibling, then insert into the correct half
+            Leaf* right = new Leaf();
+            size_t half = KEYS / 2;
+            right->count = static_cast<uint16_t>(KEYS - half);
+            copy(leaf->keys + half, leaf->keys + KEYS, right->keys);
+            copy(leaf->multiplicity + half, leaf->multiplicity + KEYS, right->multiplicity);
+            right->total = sumMultiplicity(right, 0, right->count);
+            leaf->count = static_cast<uint16_t>(half);
+            leaf->total -= right->total;
+
+            right->next = leaf->next;
+            right->prev = leaf;
+            if (leaf->next) leaf->next->prev = right; else tail = right;
+            leaf->next = right;
+
+            if (pos <= half) insertIntoLeaf(leaf, pos, value);
+            else insertIntoLeaf(right, pos - half, value);
+            split.right = right;
+            split.separator = right->keys[0];
+            return true;
+        }
+
+        Inner* inner = static_cast<Inner*>(node);
+        size_t index = route(inner, value);
+        Split childSplit;
+        if (!insertInto(inner->children[index], value, childSplit)) return false;
+        ++inner->total;
+        inner->counts[index] = inner->children[index]->total;
+        if (!childSplit.right) return true;
+
+        if (inner->count < KEYS) {
+            insertChild(inner, index, childSplit.separator, childSplit.right);
+            return true;
+        }
+
+        // Full: lay the node out with the new child in place, then split around the middle key
+        T keys[KEYS + 1];
+        Node* children[KEYS + 2];
+        size_t counts[KEYS + 2];
+        copy(inner->keys, inner->keys + index, keys);
+        keys[index] = childSplit.separator;
+        copy(inner->keys + index, inner->keys + KEYS, keys + index + 1);
+        copy(inner->children, inner->children + index + 1, children);
+        children[index + 1] = childSplit.right;
+        copy(inner->children + index + 1, inner->children + KEYS + 1, children + index + 2);
+        copy(inner->counts, inner->counts + index + 1, counts);
+        counts[index + 1] = childSplit.right->total;
+        copy(inner->counts + index + 1, inner->counts + KEYS + 1, counts + index + 2);
+
+        size_t mid = (KEYS + 1) / 2;
+        Inner* right = new Inner();
+        inner->count = static_cast<uint16_t>(mid);
+        copy(keys, keys + mid, inner->keys);
+        copy(children, children + mid + 1, inner->children);
+        copy(counts, counts + mid + 1, inner->counts);
+        right->count = static_cast<uint16_t>(KEYS - mid);
+        copy(keys + mid + 1, keys + KEYS + 1, right->keys);
+        copy(children + mid + 1, children + KEYS + 2, right->children);
+        copy(counts + mid + 1, counts + KEYS + 2, right->counts);
+
+        inner->total = sumCounts(inner);
+        right->total = sumCounts(right);
+        split.right = right;
+        split.separator = keys[mid];
+        return true;
+    }
+
+    static size_t sumCounts(const Inner* inner) {
+        size_t total = 0;
+        for (size_t i = 0; i <= inner->count; ++i) total += inner->counts[i];
+        return total;
+    }
+
+    // Put separator at keys[index] and child right of it; the node must have room
+    static void insertChild(Inner* inner, size_t index, const T& separator, Node* child) {
+        move_backward(inner->keys + index, inner->keys + inner->count, inner->keys + inner->count + 1);
+        move_backward(inner->children + index + 1, inner->children + inner->count + 1, inner->children + inner->count + 2);
+        move_backward(inner->counts + index + 1, inner->counts + inner->count + 1, inner->counts + inner->count + 2);
+        inner->keys[index] = separator;
+        inner->children[index + 1] = child;
+        inner->counts[index + 1] = child->total;
+        ++inner->count;
+    }
+
+    // Drop keys[index] and the child right of it
+    static void eraseChild(Inner* inner, size_t index) {
+        move(inner->keys + index + 1, inner->keys + inner->count, inner->keys + index);
+        move(inner->children + index + 2, inner->children + inner->count + 1, inner->children + index + 1);
+        move(inner->counts + index + 2, inner->counts + inner->count + 1, inner->counts + index + 1);
+        --inner->count;
+    }
+
+    /// Removal
+
+    bool removeFrom(Node* node, const T& value) {
+        if (node->leaf) {
+            Leaf* leaf = static_cast<Leaf*>(node);
+            size_t pos = rankInNode(leaf->keys, leaf->count, value, false);
+            if (pos == leaf->count || value < leaf->keys[pos]) return false;
+            --leaf->total;
+            if (--leaf->multiplicity[pos] > 0) return true;
+            move(leaf->keys + pos + 1, leaf->keys + leaf->count, leaf->keys + pos);
+            move(leaf->multiplicity + pos + 1, leaf->multiplicity + leaf->count, leaf->multiplicity + pos);
+            --leaf->count;
+            return true;
+        }
+
+        Inner* inner = static_cast<Inner*>(node);
+        size_t index = route(inner, value);
+        if (!removeFrom(inner->children[index], value)) return false;
+        --inner->total;
+        inner->counts[index] = inner->children[index]->total;
+        if (inner->children[index]->count < MIN_KEYS) rebalance(inner, index);
+        return true;
+    }
+
+    // children[index] fell below half full: borrow one key from a sibling, or merge with it
+    void rebalance(Inner* parent, size_t index) {
+        Node* child = parent->children[index];
+        Node* left = index > 0 ? parent->children[index - 1] : nullptr;
+        Node* right = index < parent->count ? parent->children[index + 1] : nullptr;
+
+        if (child->leaf) {
+            Leaf* leaf = static_cast<Leaf*>(child);
+            if (left && left->count > MIN_KEYS) {
+                Leaf* from = static_cast<Leaf*>(left);
+                uint32_t moved = from->multiplicity[from->count - 1];
+                insertIntoLeaf(leaf, 0, from->keys[from->count - 1]);
+                leaf->multiplicity[0] = moved;
+                leaf->total += moved - 1;
+                from->total -= moved;
+                --from->count;
+                parent->keys[index - 1] = leaf->keys[0];
+            } else if (right && right->count > MIN_KEYS) {
+                Leaf* from = static_cast<Leaf*>(right);
+                uint32_t moved = from->multiplicity[0];
+                insertIntoLeaf(leaf, leaf->count, from->keys[0]);
+                leaf->multiplicity[leaf->count - 1] = moved;
+                leaf->total += moved - 1;
+                from->total -= moved;
+                move(from->keys + 1, from->keys + from->count, from->keys);
+                move(from->multiplicity + 1, from->multiplicity + from->count, from->multiplicity);
+                --from->count;
+                parent->keys[index] = from->keys[0];
+            } else if (left) {
+                mergeLeaves(static_cast<Leaf*>(left), leaf);
+                eraseChild(parent, index - 1);
+                index -= 1;
+            } else {
+                mergeLeaves(leaf, static_cast<Leaf*>(right));
+                eraseChild(parent, index);
+            }
+        } else {
+            Inner* node = static_cast<Inner*>(child);
+            if (left && left->count > MIN_KEYS) {
+                Inner* from = static_cast<Inner*>(left);
+                move_backward(node->keys, node->keys + node->count, node->keys + node->count + 1);
+                move_backward(node->children, node->children + node->count + 1, node->children + node->count + 2);
+                move_backward(node->counts, node->counts + node->count + 1, node->counts + node->count + 2);
+                node->keys[0] = parent->keys[index - 1];
+                node->children[0] = from->children[from->count];
+                node->counts[0] = from->counts[from->count];
+                parent->keys[index - 1] = from->keys[from->count - 1];
+                ++node->count;
+                --from->count;
+                node->total += node->counts[0];
+                from->total -= node->counts[0];
+            } else if (right && right->count > MIN_KEYS) {
+                Inner* from = static_cast<Inner*>(right);
+                node->keys[node->count] = parent->keys[index];
+                node->children[node->count + 1] = from->children[0];
+                node->counts[node->count + 1] = from->counts[0];
+                parent->keys[index] = from->keys[0];
+                ++node->count;
+                node->total += from->counts[0];
+                from->total -= from->counts[0];
+                move(from->keys + 1, from->keys + from->count, from->keys);
+                move(from->children + 1, from->children + from->count + 1, from->children);
+                move(from->counts + 1, from->counts + from->count + 1, from->counts);
+                --from->count;
+            } else if (left) {
+                mergeInners(static_cast<Inner*>(left), parent->keys[index - 1], node);
+                eraseChild(parent, index - 1);
+                index -= 1;
+            } else {
+                mergeInners(node, parent->keys[index], static_cast<Inner*>(right));
+                eraseChild(parent, index);
+            }
+        }
+
+        // Refresh the counts of whichever children survived around index
+        for (size_t i = index > 0 ? index - 1 : 0; i <= min<size_t>(index + 1, parent->count); ++i) {
+            parent->counts[i] = parent->children[i]->total;
+        }
+    }
+
+    // Append right's keys to left and free right
+    void mergeLeaves(Leaf* left, Leaf* right) {
+        copy(right->keys, right->keys + right->count, left->keys + left->count);
+        copy(right->multiplicity, right->multiplicity + right->count, left->multiplicity + left->count);
+        left->count += right->count;
+        left->total += right->total;
+        left->next = right->next;
+        if (right->next) right->next->prev = left; else tail = left;
+        delete right;
+    }
+
+    // Pull the separator down between left's and right's entries and free right
+    static void mergeInners(Inner* left, const T& separator, Inner* right) {
+        left->keys[left->count] = separator;
+        copy(right->keys, right->keys + right->count, left->keys + left->count + 1);
+        copy(right->children, right->children + right->count + 1, left->children + left->count + 1);
+        copy(right->counts, right->counts + right->count + 1, left->counts + left->count + 1);
+        left->count += 1 + right->count;
+        left->total += right->total;
+        delete right;
+    }
+
+    /// Bulk load
+
+    // Split n items into ceil(n / capacity) groups of near-equal size, so every group but a
+    // lone root is at least half full
+    static vector<size_t> groupSizes(size_t n, size_t capacity) {
+        size_t groups = (n + capacity - 1) / capacity;
+        vector<size_t> sizes(groups, n / groups);
+        for (size_t i = 0; i < n % groups; ++i) ++sizes[i];
+        return sizes;
+    }
+
+    void destroy(Node* node) {
+        if (!node->leaf) {
+            Inner* inner = static_cast<Inner*>(node);
+            for (size_t i = 0; i <= inner->count; ++i) destroy(inner->children[i]);
+            delete inner;
+        } else {
+            delete static_cast<Leaf*>(node);
+        }
+    }
+
+    void reset() {
+        head = tail = new Leaf();
+        root = head;
+        levels = 1;
+    }
+
+public:
+    // Bidirectional in-order iterator; equal values are visited once per copy. Any insert or
+    // remove invalidates every iterator.
+    class const_iterator {
+    private:
+        friend class BPlusTree;
+        const BPlusTree* tree;
+        const Leaf* leaf; // nullptr means end()
+        size_t index;
+        uint32_t copy;
+
+        const_iterator(const BPlusTree* owner, const Leaf* at, size_t position)
+            : tree(owner), leaf(at), index(position), copy(0) {
+            // A bound can land just past a leaf's last key; that is the next leaf's first
+            if (leaf && index == leaf->count) {
+                leaf = leaf->next;
+                index = 0;
+            }
+        }
+
+    public:
+        using iterator_category = bidirectional_iterator_tag;
+        using value_type = T;
+        using difference_type = ptrdiff_t;
+        using pointer = const T*;
+        using reference = const T&;
+
+        const T& operator*() const { return leaf->keys[index]; }
+        const T* operator->() const { return &leaf->keys[index]; }
+
+        const_iterator& operator++() {
+            if (++copy < leaf->multiplicity[index]) return *this;
+            copy = 0;
+            if (++index == leaf->count) {
+                leaf = leaf->next;
+                index = 0;
+            }
+            return *this;
+        }
+
+        // Decrementing end() moves to the largest value
+        const_iterator& operator--() {
+            if (!leaf) {
+                leaf = tree->tail;
+                index = leaf->count - 1;
+                copy = leaf->multiplicity[index] - 1;
+                return *this;
+            }
+            if (copy > 0) {
+                --copy;
+                return *this;
+            }
+            if (index == 0) {
+                leaf = leaf->prev;
+                index = leaf->count;
+            }
+            --index;
+            copy = leaf->multiplicity[index] - 1;
+            return *this;
+        }
+
+        bool operator==(const const_iterator& other) const {
+            return leaf == other.leaf && (!leaf || (index == other.index && copy == other.copy));
+        }
+
+        bool operator!=(const const_iterator& other) const { return !(*this == other); }
+    };
+
+    BPlusTree(bool allowDuplicates = false) : duplicates(allowDuplicates) { reset(); }
+
+    ~BPlusTree() { destroy(root); }
+
+    BPlusTree(const BPlusTree&) = delete;
+    BPlusTree& operator=(const BPlusTree&) = delete;
+
+    void insert(const T& value) {
+        Split split;
+        if (!insertInto(root, value, split) || !split.right) return;
+
+        Inner* newRoot = new Inner();
+        newRoot->count = 1;
+        newRoot->keys[0] = split.separator;
+        newRoot->children[0] = root;
+        newRoot->children[1] = split.right;
+        newRoot->counts[0] = root->total;
+        newRoot->counts[1] = split.right->total;
+        newRoot->total = root->total + split.right->total;
+        root = newRoot;
+        ++levels;
+    }
+
+    // Removes one copy of value; does nothing if it is absent
+    void remove(const T& value) {
+        removeFrom(root, value);
+        if (!root->leaf && root->count == 0) {
+            Inner* oldRoot = static_cast<Inner*>(root);
+            root = oldRoot->children[0];
+            delete oldRoot;
+            --levels;
+        }
+    }
+
+    // Replace the contents with ascending values in O(n), packing leaves and inner nodes evenly
+    void buildFromSorted(const vector<T>& values) {
+        if (!is_sorted(values.begin(), values.end())) throw invalid_argument("Values must be sorted.");
+        clear();
+        if (values.empty()) return;
+
+        // Collapse runs of equal values into one key with a multiplicity
+        vector<T> keys;
+        vector<uint32_t> copies;
+        for (const T& value : values) {
+            if (!keys.empty() && !(keys.back() < value)) {
+                if (duplicates) ++copies.back();
+                continue;
+            }
+            keys.push_back(value);
+            copies.push_back(1);
+        }
+
+        // Leaf level, chained left to right; level holds each node and its smallest key
+        delete head;
+        vector<pair<Node*, T>> level;
+        Leaf* previous = nullptr;
+        size_t next = 0;
+        for (size_t size : groupSizes(keys.size(), KEYS)) {
+            Leaf* leaf = new Leaf();
+            leaf->count = static_cast<uint16_t>(size);
+            copy(keys.begin() + next, keys.begin() + next + size, leaf->keys);
+            copy(copies.begin() + next, copies.begin() + next + size, leaf->multiplicity);
+            leaf->total = sumMultiplicity(leaf, 0, size);
+            leaf->prev = previous;
+            if (previous) previous->next = leaf; else head = leaf;
+            previous = leaf;
+            level.emplace_back(leaf, leaf->keys[0]);
+            next += size;
+        }
+        tail = previous;
+        levels = 1;
+
+        // Inner levels until a single root remains
+        while (level.size() > 1) {
+            vector<pair<Node*, T>> parents;
+            size_t first = 0;
+            for (size_t size : groupSizes(level.size(), KEYS + 1)) {
+                Inner* inner = new Inner();
+                inner->count = static_cast<uint16_t>(size - 1);
+                for (size_t i = 0; i < size; ++i) {
+                    Node* child = level[first + i].first;
+                    inner->children[i] = child;
+                    inner->counts[i] = child->total;
+                    inner->total += child->total;
+                    if (i > 0) inner->keys[i - 1] = level[first + i].second;
+                }
+                parents.emplace_back(inner, level[first].second);
+                first += size;
+            }
+            level.swap(parents);
+            ++levels;
+        }
+        root = level[0].first;
+    }
+
+    bool contains(const T& value) const {
+        const Leaf* leaf = findLeaf(value);
+        size_t pos = rankInNode(leaf->keys, leaf->count, value, false);
+        return pos < leaf->count && !(value < leaf->keys[pos]);
+    }
+
+    bool search(const T& value) const { return contains(value); }
+
+    const_iterator begin() const { return const_iterator(this, head->count ? head : nullptr, 0); }
+
+    const_iterator end() const { return const_iterator(this, nullptr, 0); }
+
+    // First value >= value, or end()
+    const_iterator lowerBound(const T& value) const {
+        const Leaf* leaf = findLeaf(value);
+        return const_iterator(this, leaf, rankInNode(leaf->keys, leaf->count, value, false));
+    }
+
+    // First value > value, or end()
+    const_iterator upperBound(const T& value) const {
+        const Leaf* leaf = findLeaf(value);
+        return const_iterator(this, leaf, rankInNode(leaf->keys, leaf->count, value, true));
+    }
+
+    // The k-th smallest value, counting from 0 and counting every copy
+    T select(size_t k) const {
+        if (k >= root->total) throw out_of_range("Index out of range.");
+        const Node* node = root;
+        while (!node->leaf) {
+            const Inner* inner = static_cast<const Inner*>(node);
+            size_t i = 0;
+            while (k >= inner->counts[i]) k -= inner->counts[i++];
+            node = inner->children[i];
+        }
+        const Leaf* leaf = static_cast<const Leaf*>(node);
+        size_t i = 0;
+        while (k >= leaf->multiplicity[i]) k -= leaf->multiplicity[i++];
+        return leaf->keys[i];
+    }
+
+    // How many stored values are smaller than value
+    size_t rank(const T& value) const {
+        size_t smaller = 0;
+        const Node* node = root;
+        while (!node->leaf) {
+            const Inner* inner = static_cast<const Inner*>(node);
+            size_t index = route(inner, value);
+            for (size_t i = 0; i < index; ++i) smaller += inner->counts[i];
+            node = inner->children[index];
+        }
+        const Leaf* leaf = static_cast<const Leaf*>(node);
+        return smaller + sumMultiplicity(leaf, 0, rankInNode(leaf->keys, leaf->count, value, false));
+    }
+
+    T findMin() const {
+        if (isEmpty()) throw runtime_error("Tree is empty.");
+        return head->keys[0];
+    }
+
+    T findMax() const {
+        if (isEmpty()) throw runtime_error("Tree is empty.");
+        return tail->keys[tail->count - 1];
+    }
+
+    string inorderAsString() const {
+        ostringstream oss;
+        for (const T& value : *this) oss << value << " ";
+        return oss.str();
+    }
+
+    // Values in ascending order
+    vector<T> toVector() const {
+        vector<T> values;
+        values.reserve(size());
+        for (const T& value : *this) values.push_back(value);
+        return values;
+    }
+
+    void displayInOrder() const { cout << inorderAsString() << endl; }
+
+    size_t size() const { return root->total; }
+
+    bool isEmpty() const { return root->total == 0; }
+
+    // Levels from root to leaves; every leaf is at the same depth, so the tree is always balanced
+    int getHeight() const { return isEmpty() ? 0 : levels; }
+
+    bool isBalanced() const { return true; }
+
+    void clear() {
+        destroy(root);
+        reset();
+    }
+};
+
+#endif // BPLUSTREE_H
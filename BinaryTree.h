@@ -1,10 +1,12 @@
 #ifndef BINARYTREE_H
 #define BINARYTREE_H
 
+#include <algorithm>
 #include <iostream>
 #include <stdexcept>
 #include <sstream>
 #include <functional>
+#include <vector>
 using namespace std;
 
 template <typename T>
@@ -36,6 +38,24 @@ private:
         inorder(node->right, oss);
     }
 
+    void inorder(Node* node, vector<T>& values) const {
+        if (!node) return;
+        inorder(node->left, values);
+        values.push_back(node->data);
+        inorder(node->right, values);
+    }
+
+    // Balanced subtree over values[lo, hi): the middle element becomes the root. Equal values
+    // may land on either side, which search and remove handle since they stop at the first match.
+    Node* buildBalanced(const vector<T>& values, size_t lo, size_t hi) {
+        if (lo >= hi) return nullptr;
+        size_t mid = lo + (hi - lo) / 2;
+        Node* node = new Node(values[mid]);
+        node->left = buildBalanced(values, lo, mid);
+        node->right = buildBalanced(values, mid + 1, hi);
+        return node;
+    }
+
     Node* search(Node* node, const T& value) const {
         if (!node || node->data == value) return node;
         if (value < node->data) return search(node->left, value);
@@ -118,6 +138,14 @@ public:
 
     void insert(const T& value) { insert(root, value); }
 
+    // Replace the contents with ascending values in O(n), giving a height-balanced tree
+    // instead of the right-leaning chain that inserting them one by one would build
+    void buildFromSorted(const vector<T>& values) {
+        if (!is_sorted(values.begin(), values.end())) throw invalid_argument("Values must be sorted.");
+        clear();
+        root = buildBalanced(values, 0, values.size());
+    }
+
     bool search(const T& value) const { return search(root, value) != nullptr; }
 
     void displayInOrder() const {
@@ -132,6 +160,13 @@ public:
         return oss.str();
     }
 
+    // Values in ascending order
+    vector<T> toVector() const {
+        vector<T> values;
+        inorder(root, values);
+        return values;
+    }
+
     T findMax() const { return findMax(root); }
 
     T findMin() const { return findMin(root); }
@@ -4,6 +4,7 @@
 #include <iostream>
 #include <sstream>
 #include <stdexcept>
+#include <vector>
 using namespace std;
 
 template <typename T>
@@ -97,6 +98,20 @@ public:
         return result;
     }
 
+    // Convert the list to a vector, starting from the head
+    vector<T> toVector() const {
+        vector<T> result;
+        result.reserve(size);
+        if (size == 0) return result;
+
+        Node* current = tail->next;
+        do {
+            result.push_back(current->data);
+            current = current->next;
+        } while (current != tail->next);
+        return result;
+    }
+
     // Display the list
     void display() const {
         if (size == 0) {
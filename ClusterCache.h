@@ -0,0 +1,405 @@
+#ifndef CLUSTERCACHE_H
+#define CLUSTERCACHE_H
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstdlib>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <shared_mutex>
+#include <sstream>
+#include <string>
+#include <string_view>
+#include <vector>
+#include "Data Structures/CircularLinkedList.h"
+#include "Data Structures/FlatHashTable.h"
+#include "Data Structures/Queue.h"
+#include "Data Structures/BinaryTree.h"
+#include "Data Structures/AVLTree.h"
+#include "Data Structures/BPlusTree.h"
+#include "Data Structures/CsrGraph.h"
+#include "Data Structures/Heap.h"
+#include "Data Structures/DaryHeap.h"
+#include "Data Structures/PairingHeap.h"
+#include "ConcurrentHashTable.h"
+#include "PayloadParser.h"
+#include "SnapshotBuffer.h"
+using namespace std;
+
+// Which structure backs BinaryTree and AVLTree clusters. Node is the original pointer trees;
+// BTree keeps both in a cache-friendly B+tree (duplicates kept for BinaryTree, dropped for
+// AVLTree, as before). Snapshots store sorted values either way, so the engine can change
+// between restarts.
+enum class TreeEngine { Node, BTree };
+
+// Chosen once per process from NRDB_TREE_ENGINE ("btree" or "node"; node if unset)
+inline TreeEngine configuredTreeEngine() {
+    static const TreeEngine engine = [] {
+        const char* setting = getenv("NRDB_TREE_ENGINE");
+        return setting && string(setting) == "btree" ? TreeEngine::BTree : TreeEngine::Node;
+    }();
+    return engine;
+}
+
+// Which structure backs Heap clusters. Indexed is the binary Heap, which builds its value index
+// only once an EDIT_DATA needs it and then keeps edits O(log n); Dary (4-ary) and Pairing find
+// the edited value by scanning. All three snapshot as a plain value array, so the engine can
+// change between restarts.
+enum class HeapEngine { Indexed, Dary, Pairing };
+
+// Chosen once per process from NRDB_HEAP_ENGINE ("dary", "pairing" or "indexed"; indexed if unset)
+inline HeapEngine configuredHeapEngine() {
+    static const HeapEngine engine = [] {
+        const char* setting = getenv("NRDB_HEAP_ENGINE");
+        string name = setting ? setting : "";
+        if (name == "dary") return HeapEngine::Dary;
+        if (name == "pairing") return HeapEngine::Pairing;
+        return HeapEngine::Indexed;
+    }();
+    return engine;
+}
+
+// Shards per Hashtable cluster: enough for parallel readers, small enough for many small clusters
+const size_t HASHTABLE_CLUSTER_SHARDS = 16;
+
+// A resident cluster: the live data structure for its data type plus bookkeeping for the
+// background flusher. Handlers must hold `lock` while touching any member: shared to read,
+// exclusive to change anything. The one exception is a write that leaves a Hashtable cluster
+// a Hashtable: the table locks its own shards, so such a write holds `lock` shared plus
+// `writerLock`, and may then change the table, lsn and dirty.
+struct Cluster {
+    shared_mutex lock;
+    // Hashtable writes hold lock shared so lookups keep running; this orders those writers
+    // against each other, so their log records match the order they were applied in
+    mutex writerLock;
+    string dataType; // Empty until the first ADD_DATA picks a type
+    bool dirty = false;   // Changed since it was last written to disk
+    bool deleted = false; // Removed by DELETE_CLUSTER; never flush again
+    uint64_t lsn = 0;     // Last write-ahead log record applied to this cluster
+
+    unique_ptr<CircularLinkedList<string>> linkedList;
+    unique_ptr<ConcurrentHashTable<string, string>> hashtable; // Sharded, so lookups run alongside writers
+    unique_ptr<Queue<string>> queue;
+    unique_ptr<BinaryTree<int>> binaryTree;
+    unique_ptr<AVLTree<int>> avlTree;
+    unique_ptr<BPlusTree<int>> orderedTree; // BinaryTree or AVLTree data under TreeEngine::BTree
+    unique_ptr<CsrGraph<string>> graph;
+    unique_ptr<Heap<int>> heap;
+    unique_ptr<DaryHeap<int>> daryHeap;       // Heap data under HeapEngine::Dary
+    unique_ptr<PairingHeap<int>> pairingHeap; // Heap data under HeapEngine::Pairing
+
+    // Graphs persist as a base snapshot plus an append-only edge log (see Snapshot.h). While
+    // every change since those were written is an edge addition, the new edges wait here as
+    // edge-log records and the next checkpoint only appends them.
+    bool edgesOnly = false;
+    SnapshotWriter pendingEdges;
+    size_t snapshotBytes = 0; // Base snapshot size on disk
+    size_t edgeLogBytes = 0;  // Edge log size on disk
+};
+
+// The next checkpoint has to rewrite the whole snapshot
+inline void requireFullSnapshot(Cluster& cluster) {
+    cluster.edgesOnly = false;
+    cluster.pendingEdges = SnapshotWriter();
+}
+
+// One edge-log record: both node names as u32 length and bytes, then the f64 weight
+inline void encodeEdgeRecord(SnapshotWriter& out, const string& from, const string& to, double weight) {
+    out.putString(from);
+    out.putString(to);
+    out.put<double>(weight);
+}
+
+inline bool isSupportedDataType(const string& dataType) {
+    return dataType == "CircularLinkedList" || dataType == "Hashtable" || dataType == "Queue" ||
+           dataType == "BinaryTree" || dataType == "AVLTree" || dataType == "Graph" || dataType == "Heap";
+}
+
+template <typename HeapType>
+inline string heapAsString(const HeapType& heap) {
+    ostringstream oss;
+    for (const auto& value : heap.toVector()) oss << value << " ";
+    return oss.str();
+}
+
+// Render the cluster contents in the text format ADD_DATA accepts, so it can be parsed back
+inline string clusterDataAsString(const Cluster& cluster) {
+    if (cluster.linkedList) return cluster.linkedList->asString();
+    if (cluster.hashtable) return cluster.hashtable->asString();
+    if (cluster.queue) {
+        ostringstream oss;
+        const Queue<string>& queue = *cluster.queue;
+        for (size_t i = 0; i < queue.size(); ++i) oss << queue[i] << " ";
+        string result = oss.str();
+        if (!result.empty()) result.pop_back();
+        return result;
+    }
+    if (cluster.binaryTree) return cluster.binaryTree->inorderAsString();
+    if (cluster.avlTree) return cluster.avlTree->inorderAsString();
+    if (cluster.orderedTree) return cluster.orderedTree->inorderAsString();
+    if (cluster.graph) return cluster.graph->edgesAsString();
+    if (cluster.heap) return heapAsString(*cluster.heap);
+    if (cluster.daryHeap) return heapAsString(*cluster.daryHeap);
+    if (cluster.pairingHeap) return heapAsString(*cluster.pairingHeap);
+    return "";
+}
+
+// Strip a ":weight" suffix from the second node of an edge (node1-node2:weight). A suffix that
+// isn't a finite number stays part of the name, as before weights existed; false for a
+// negative weight, which the edge is skipped for.
+inline bool splitEdgeWeight(string_view& node, double& weight) {
+    weight = 1.0;
+    size_t colon = node.rfind(':');
+    if (colon == string_view::npos) return true;
+    double parsed;
+    if (!parseDouble(node.substr(colon + 1), parsed) || !isfinite(parsed)) return true;
+    if (parsed < 0) return false;
+    weight = parsed;
+    node = node.substr(0, colon);
+    return true;
+}
+
+// Loading a dump (legacy files, type changes, the first ADD_DATA) fills an empty tree, so build it
+// balanced in one pass; later additions go through the ordinary insert
+template <typename Tree>
+inline void appendTreeData(Tree& tree, string_view data) {
+    vector<int> values;
+    parseIntList(data, values);
+
+    if (tree.isEmpty()) {
+        sort(values.begin(), values.end());
+        tree.buildFromSorted(values);
+        return;
+    }
+    for (int item : values) tree.insert(item);
+}
+
+// Like the trees, a dump loaded into an empty heap is heapified in one O(n) pass
+template <typename HeapType>
+inline void appendHeapData(HeapType& heap, string_view data) {
+    vector<int> values;
+    parseIntList(data, values);
+
+    if (heap.isEmpty()) {
+        heap.buildHeap(values);
+        return;
+    }
+    for (int item : values) heap.insert(item);
+}
+
+// Parse a payload in the text format of the cluster's data type and add it to the live structure.
+// Names are staged in reused strings, so parsing itself doesn't allocate per value.
+inline void appendClusterData(Cluster& cluster, string_view data) {
+    string key, value;
+    if (cluster.linkedList) {
+        TokenCursor tokens(data);
+        for (string_view token = tokens.next(); !token.empty(); token = tokens.next()) {
+            value.assign(token);
+            cluster.linkedList->insert(value);
+        }
+    } else if (cluster.hashtable) {
+        FieldCursor pairs(data, ',');
+        for (string_view pair; pairs.next(pair);) {
+            size_t pos = pair.find(':');
+            if (pos == string_view::npos) continue;
+            key.assign(pair.substr(0, pos));
+            value.assign(pair.substr(pos + 1));
+            cluster.hashtable->insert(key, value);
+        }
+    } else if (cluster.queue) {
+        TokenCursor tokens(data);
+        vector<string> values;
+        for (string_view token = tokens.next(); !token.empty(); token = tokens.next()) values.emplace_back(token);
+        cluster.queue->enqueueRange(values);
+    } else if (cluster.binaryTree) {
+        appendTreeData(*cluster.binaryTree, data);
+    } else if (cluster.avlTree) {
+        appendTreeData(*cluster.avlTree, data);
+    } else if (cluster.orderedTree) {
+        appendTreeData(*cluster.orderedTree, data);
+    } else if (cluster.graph) {
+        FieldCursor edges(data, ',');
+        for (string_view edge; edges.next(edge);) {
+            size_t pos = edge.find('-');
+            if (pos == string_view::npos) continue;
+            string_view target = edge.substr(pos + 1);
+            double weight;
+            if (!splitEdgeWeight(target, weight)) continue;
+            key.assign(edge.substr(0, pos));
+            value.assign(target);
+            cluster.graph->addEdge(key, value, weight);
+            if (cluster.edgesOnly) encodeEdgeRecord(cluster.pendingEdges, key, value, weight);
+        }
+        // Once the log would outgrow the snapshot, rewriting the snapshot is the cheaper checkpoint
+        if (cluster.edgesOnly && cluster.edgeLogBytes + cluster.pendingEdges.data().size() > cluster.snapshotBytes) {
+            requireFullSnapshot(cluster);
+        }
+    } else if (cluster.heap) {
+        appendHeapData(*cluster.heap, data);
+    } else if (cluster.daryHeap) {
+        appendHeapData(*cluster.daryHeap, data);
+    } else if (cluster.pairingHeap) {
+        appendHeapData(*cluster.pairingHeap, data);
+    }
+}
+
+// Both values are parsed before the heap is touched, so a bad newValue can't lose the old one
+template <typename HeapType>
+inline bool replaceHeapValue(HeapType& heap, const string& key, const string& newValue) {
+    int oldValue, value;
+    if (!parseInt(key, oldValue) || !parseInt(newValue, value)) return false;
+    try {
+        heap.remove(oldValue);
+    } catch (const invalid_argument&) {
+        return false;
+    }
+    heap.insert(value);
+    return true;
+}
+
+// The trees don't support direct key modification, so we remove and reinsert
+template <typename Tree>
+inline bool replaceTreeValue(Tree& tree, const string& key, const string& newValue) {
+    int oldValue, value;
+    if (!parseInt(key, oldValue) || !parseInt(newValue, value)) return false;
+    tree.remove(oldValue);
+    tree.insert(value);
+    return true;
+}
+
+// Replace key with newValue (a hashtable key's value, a node name, or a stored value).
+// Returns false and leaves the cluster untouched when there is nothing to replace, or when a tree
+// or heap value isn't an int.
+inline bool editClusterData(Cluster& cluster, const string& key, const string& newValue) {
+    if (cluster.hashtable) {
+        return cluster.hashtable->update(key, [&newValue](string& value) { value = newValue; });
+    }
+    if (cluster.linkedList) {
+        // Rotate the list once, replacing matches (Linked List doesn't have key-value pair)
+        bool found = false;
+        size_t size = cluster.linkedList->getSize();
+        for (size_t i = 0; i < size; i++) {
+            string current = cluster.linkedList->remove();
+            if (current == key) {
+                cluster.linkedList->insert(newValue);
+                found = true;
+            } else {
+                cluster.linkedList->insert(current);
+            }
+        }
+        return found;
+    }
+    if (cluster.queue) {
+        return cluster.queue->replace(key, newValue) > 0;
+    }
+    if (cluster.binaryTree) return replaceTreeValue(*cluster.binaryTree, key, newValue);
+    if (cluster.avlTree) return replaceTreeValue(*cluster.avlTree, key, newValue);
+    if (cluster.orderedTree) return replaceTreeValue(*cluster.orderedTree, key, newValue);
+    if (cluster.graph) {
+        if (!cluster.graph->renameNode(key, newValue)) return false;
+        requireFullSnapshot(cluster);
+        return true;
+    }
+    if (cluster.heap) return replaceHeapValue(*cluster.heap, key, newValue);
+    if (cluster.daryHeap) return replaceHeapValue(*cluster.daryHeap, key, newValue);
+    if (cluster.pairingHeap) return replaceHeapValue(*cluster.pairingHeap, key, newValue);
+    return false;
+}
+
+// Drop the contents but keep the data type
+inline void clearClusterData(Cluster& cluster) {
+    if (cluster.linkedList) cluster.linkedList->clear();
+    if (cluster.hashtable) cluster.hashtable->clear();
+    if (cluster.queue) cluster.queue->clear();
+    if (cluster.binaryTree) cluster.binaryTree->clear();
+    if (cluster.avlTree) cluster.avlTree->clear();
+    if (cluster.orderedTree) cluster.orderedTree->clear();
+    if (cluster.graph) {
+        cluster.graph->clear();
+        requireFullSnapshot(cluster);
+    }
+    if (cluster.heap) cluster.heap->clear();
+    if (cluster.daryHeap) cluster.daryHeap->clear();
+    if (cluster.pairingHeap) cluster.pairingHeap->clear();
+}
+
+// Give the cluster a data type. Existing contents are carried over through their text form,
+// which is what re-reading the stored data as the new type used to do.
+inline void setClusterType(Cluster& cluster, const string& dataType) {
+    if (cluster.dataType == dataType) return;
+
+    string existing = clusterDataAsString(cluster);
+    requireFullSnapshot(cluster);
+    cluster.linkedList.reset();
+    cluster.hashtable.reset();
+    cluster.queue.reset();
+    cluster.binaryTree.reset();
+    cluster.avlTree.reset();
+    cluster.orderedTree.reset();
+    cluster.graph.reset();
+    cluster.heap.reset();
+    cluster.daryHeap.reset();
+    cluster.pairingHeap.reset();
+
+    if (dataType == "CircularLinkedList") cluster.linkedList.reset(new CircularLinkedList<string>());
+    else if (dataType == "Hashtable") {
+        // A client-driven table can reach millions of keys; don't stall a request on one big rehash
+        cluster.hashtable.reset(new ConcurrentHashTable<string, string>(HASHTABLE_CLUSTER_SHARDS));
+        cluster.hashtable->setResizeMode(ResizeMode::Incremental);
+    }
+    else if (dataType == "Queue") cluster.queue.reset(new Queue<string>());
+    else if (dataType == "BinaryTree" && configuredTreeEngine() == TreeEngine::BTree) cluster.orderedTree.reset(new BPlusTree<int>(true));
+    else if (dataType == "BinaryTree") cluster.binaryTree.reset(new BinaryTree<int>());
+    else if (dataType == "AVLTree" && configuredTreeEngine() == TreeEngine::BTree) cluster.orderedTree.reset(new BPlusTree<int>(false));
+    else if (dataType == "AVLTree") cluster.avlTree.reset(new AVLTree<int>());
+    else if (dataType == "Graph") cluster.graph.reset(new CsrGraph<string>());
+    else if (dataType == "Heap" && configuredHeapEngine() == HeapEngine::Dary) cluster.daryHeap.reset(new DaryHeap<int>());
+    else if (dataType == "Heap" && configuredHeapEngine() == HeapEngine::Pairing) cluster.pairingHeap.reset(new PairingHeap<int>());
+    else if (dataType == "Heap") cluster.heap.reset(new Heap<int>());
+    cluster.dataType = dataType;
+
+    appendClusterData(cluster, existing);
+}
+
+// Process-wide map of resident clusters keyed by (user, cluster). Every request looks its
+// cluster up here, so the map is sharded to let lookups from different threads run in parallel.
+class ClusterCache {
+private:
+    ConcurrentHashTable<string, shared_ptr<Cluster>> clusters;
+
+    static string key(const string& username, const string& clusterName) {
+        return username + '\0' + clusterName;
+    }
+
+public:
+    shared_ptr<Cluster> find(const string& username, const string& clusterName) const {
+        shared_ptr<Cluster> cluster;
+        clusters.tryGet(key(username, clusterName), cluster);
+        return cluster;
+    }
+
+    // Insert a loaded cluster; if another thread got there first, keep and return theirs
+    shared_ptr<Cluster> insert(const string& username, const string& clusterName, shared_ptr<Cluster> cluster) {
+        return clusters.getOrInsert(key(username, clusterName), cluster);
+    }
+
+    void erase(const string& username, const string& clusterName) {
+        clusters.erase(key(username, clusterName));
+    }
+
+    // Visit every resident cluster; the callback runs without any map lock held
+    void forEach(const function<void(const string&, const string&, const shared_ptr<Cluster>&)>& visit) const {
+        vector<pair<string, shared_ptr<Cluster>>> snapshot;
+        clusters.forEach([&snapshot](const string& clusterKey, const shared_ptr<Cluster>& cluster) {
+            snapshot.emplace_back(clusterKey, cluster);
+        });
+        for (const auto& entry : snapshot) {
+            size_t split = entry.first.find('\0');
+            visit(entry.first.substr(0, split), entry.first.substr(split + 1), entry.second);
+        }
+    }
+};
+
+#endif // CLUSTERCACHE_H
@@ -0,0 +1,96 @@
+#ifndef CLUSTERCATALOG_H
+#define CLUSTERCATALOG_H
+
+#include <cstdint>
+#include <cstdio>
+#include <filesystem>
+#include <shared_mutex>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+using namespace std;
+
+const int CLUSTER_SHARD_COUNT = 256;
+
+// FNV-1a; unlike std::hash it is stable across builds, so it can name directories on disk
+inline uint32_t stableHash(const string& text) {
+    uint32_t hash = 2166136261u;
+    for (unsigned char c : text) {
+        hash ^= c;
+        hash *= 16777619u;
+    }
+    return hash;
+}
+
+// Two hex digits picking the subdirectory a cluster's files live in, e.g. "3f"
+inline string clusterShard(const string& clusterName) {
+    char shard[3];
+    snprintf(shard, sizeof(shard), "%02x", stableHash(clusterName) % CLUSTER_SHARD_COUNT);
+    return shard;
+}
+
+// In-memory index of which clusters exist for each user. Built with one directory scan at
+// startup and kept current by CREATE_CLUSTER / DELETE_CLUSTER, so existence checks and
+// listings never touch the filesystem.
+class ClusterCatalog {
+private:
+    unordered_map<string, unordered_set<string>> clustersByUser;
+    mutable shared_mutex lock;
+
+    static bool isClusterFile(const filesystem::directory_entry& entry) {
+        string extension = entry.path().extension().string();
+        return entry.is_regular_file() && (extension == ".snap" || extension == ".json");
+    }
+
+public:
+    // Index clusters/<user>/<shard>/<cluster>.snap plus the older clusters/<user>/<cluster>.{snap,json} files
+    void load(const string& root) {
+        unique_lock<shared_mutex> guard(lock);
+        clustersByUser.clear();
+        if (!filesystem::exists(root)) return;
+
+        for (const auto& userDir : filesystem::directory_iterator(root)) {
+            if (!userDir.is_directory()) continue;
+            auto& clusters = clustersByUser[userDir.path().filename().string()];
+            for (const auto& entry : filesystem::directory_iterator(userDir.path())) {
+                if (isClusterFile(entry)) {
+                    clusters.insert(entry.path().stem().string());
+                } else if (entry.is_directory()) {
+                    for (const auto& shardEntry : filesystem::directory_iterator(entry.path())) {
+                        if (isClusterFile(shardEntry)) clusters.insert(shardEntry.path().stem().string());
+                    }
+                }
+            }
+        }
+    }
+
+    bool contains(const string& username, const string& clusterName) const {
+        shared_lock<shared_mutex> guard(lock);
+        auto it = clustersByUser.find(username);
+        return it != clustersByUser.end() && it->second.count(clusterName) > 0;
+    }
+
+    // Returns false if the cluster was already listed
+    bool add(const string& username, const string& clusterName) {
+        unique_lock<shared_mutex> guard(lock);
+        return clustersByUser[username].insert(clusterName).second;
+    }
+
+    void remove(const string& username, const string& clusterName) {
+        unique_lock<shared_mutex> guard(lock);
+        auto it = clustersByUser.find(username);
+        if (it == clustersByUser.end()) return;
+        it->second.erase(clusterName);
+        if (it->second.empty()) clustersByUser.erase(it);
+    }
+
+    vector<string> list(const string& username) const {
+        shared_lock<shared_mutex> guard(lock);
+        auto it = clustersByUser.find(username);
+        if (it == clustersByUser.end()) return {};
+        return vector<string>(it->second.begin(), it->second.end());
+    }
+};
+
+#endif // CLUSTERCATALOG_H
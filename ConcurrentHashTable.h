@@ -0,0 +1,222 @@
+#ifndef CONCURRENTHASHTABLE_H
+#define CONCURRENTHASHTABLE_H
+
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <shared_mutex>
+#include <sstream>
+#include <stdexcept>
+#include <vector>
+#include "Data Structures/FlatHashTable.h"
+using namespace std;
+
+// Thread-safe hash table built from independently locked FlatHashTable shards. Readers take a
+// shard's lock shared, so get/contains run in parallel with each other and only wait for writers
+// on the same shard; each shard grows on its own, so a resize stalls 1/shardCount of the keys.
+// There is no operator[]: a reference into a shard would outlive its lock, use update() instead.
+template <typename K, typename V, typename Hash = std::hash<K>>
+class ConcurrentHashTable {
+private:
+    // One cache line per shard header so neighbouring shard locks never share a line
+    struct alignas(64) Shard {
+        mutable shared_mutex lock;
+        FlatHashTable<K, V, Hash> table;
+    };
+
+    unique_ptr<Shard[]> shards;
+    size_t shardCount; // Power of two
+    int shardBits;
+    Hash hashFunc;
+
+    // Use the top bits of a multiplied hash so shard choice doesn't correlate with the
+    // low bits each shard's table probes with
+    Shard& shardFor(const K& key) const {
+        uint64_t h = static_cast<uint64_t>(hashFunc(key)) * 0x9e3779b97f4a7c15ULL;
+        return shards[shardBits == 0 ? 0 : h >> (64 - shardBits)];
+    }
+
+public:
+    ConcurrentHashTable(size_t shardsWanted = 64, Hash hashFunc = Hash()) : shardCount(1), shardBits(0), hashFunc(hashFunc) {
+        while (shardCount < shardsWanted) {
+            shardCount *= 2;
+            ++shardBits;
+        }
+        shards.reset(new Shard[shardCount]);
+    }
+
+    ConcurrentHashTable(const ConcurrentHashTable&) = delete;
+    ConcurrentHashTable& operator=(const ConcurrentHashTable&) = delete;
+
+    void setResizeMode(ResizeMode mode) {
+        for (size_t i = 0; i < shardCount; ++i) {
+            unique_lock<shared_mutex> guard(shards[i].lock);
+            shards[i].table.setResizeMode(mode);
+        }
+    }
+
+    // Presize every shard for count keys spread evenly, with an eighth to spare for skew
+    void reserve(size_t count) {
+        size_t perShard = count / shardCount;
+        for (size_t i = 0; i < shardCount; ++i) {
+            unique_lock<shared_mutex> guard(shards[i].lock);
+            shards[i].table.reserve(perShard + perShard / 8);
+        }
+    }
+
+    void insert(const K& key, const V& value) {
+        Shard& shard = shardFor(key);
+        unique_lock<shared_mutex> guard(shard.lock);
+        shard.table.insert(key, value);
+    }
+
+    // Insert only if key is absent; false if it was already there
+    bool insertIfAbsent(const K& key, const V& value) {
+        Shard& shard = shardFor(key);
+        unique_lock<shared_mutex> guard(shard.lock);
+        if (shard.table.contains(key)) return false;
+        shard.table.insert(key, value);
+        return true;
+    }
+
+    // The value already stored under key, or value after inserting it
+    V getOrInsert(const K& key, const V& value) {
+        Shard& shard = shardFor(key);
+        unique_lock<shared_mutex> guard(shard.lock);
+        auto* entry = shard.table.find(key);
+        if (entry) return entry->value;
+        shard.table.insert(key, value);
+        return value;
+    }
+
+    // Apply modify(value) under the shard's write lock; false if key is absent
+    template <typename Modify>
+    bool update(const K& key, Modify modify) {
+        Shard& shard = shardFor(key);
+        unique_lock<shared_mutex> guard(shard.lock);
+        auto* entry = shard.table.find(key);
+        if (!entry) return false;
+        modify(entry->value);
+        return true;
+    }
+
+    void remove(const K& key) {
+        if (!erase(key)) throw invalid_argument("Key not found.");
+    }
+
+    // Non-throwing remove; false if key was absent
+    bool erase(const K& key) {
+        Shard& shard = shardFor(key);
+        unique_lock<shared_mutex> guard(shard.lock);
+        if (!shard.table.contains(key)) return false;
+        shard.table.remove(key);
+        return true;
+    }
+
+    V get(const K& key) const {
+        Shard& shard = shardFor(key);
+        shared_lock<shared_mutex> guard(shard.lock);
+        return shard.table.get(key);
+    }
+
+    // Non-throwing get; false if key is absent
+    bool tryGet(const K& key, V& value) const {
+        Shard& shard = shardFor(key);
+        shared_lock<shared_mutex> guard(shard.lock);
+        auto* entry = shard.table.find(key);
+        if (!entry) return false;
+        value = entry->value;
+        return true;
+    }
+
+    bool contains(const K& key) const {
+        Shard& shard = shardFor(key);
+        shared_lock<shared_mutex> guard(shard.lock);
+        return shard.table.contains(key);
+    }
+
+    // Totals are summed shard by shard, so under concurrent writes they are approximate
+    size_t getSize() const {
+        size_t total = 0;
+        for (size_t i = 0; i < shardCount; ++i) {
+            shared_lock<shared_mutex> guard(shards[i].lock);
+            total += shards[i].table.getSize();
+        }
+        return total;
+    }
+
+    size_t getCapacity() const {
+        size_t total = 0;
+        for (size_t i = 0; i < shardCount; ++i) {
+            shared_lock<shared_mutex> guard(shards[i].lock);
+            total += shards[i].table.getCapacity();
+        }
+        return total;
+    }
+
+    // Shard stats summed; resizing if any shard is
+    HashTableStats getStats() const {
+        HashTableStats total = {ResizeMode::StopTheWorld, 0, 0, false, 0, 0, 0};
+        for (size_t i = 0; i < shardCount; ++i) {
+            shared_lock<shared_mutex> guard(shards[i].lock);
+            HashTableStats stats = shards[i].table.getStats();
+            total.mode = stats.mode;
+            total.size += stats.size;
+            total.capacity += stats.capacity;
+            total.resizing = total.resizing || stats.resizing;
+            total.pendingSlots += stats.pendingSlots;
+            total.resizeCount += stats.resizeCount;
+            total.tombstones += stats.tombstones;
+        }
+        return total;
+    }
+
+    size_t getShardCount() const {
+        return shardCount;
+    }
+
+    bool isEmpty() const {
+        return getSize() == 0;
+    }
+
+    void clear() {
+        for (size_t i = 0; i < shardCount; ++i) {
+            unique_lock<shared_mutex> guard(shards[i].lock);
+            shards[i].table.clear();
+        }
+    }
+
+    // Visit every key-value pair, holding one shard's read lock at a time. The visitor must
+    // not write to this table.
+    template <typename Visitor>
+    void forEach(Visitor visit) const {
+        for (size_t i = 0; i < shardCount; ++i) {
+            shared_lock<shared_mutex> guard(shards[i].lock);
+            shards[i].table.forEach(visit);
+        }
+    }
+
+    vector<K> getKeys() const {
+        vector<K> keys;
+        forEach([&keys](const K& key, const V&) { keys.push_back(key); });
+        return keys;
+    }
+
+    vector<V> getValues() const {
+        vector<V> values;
+        forEach([&values](const K&, const V& value) { values.push_back(value); });
+        return values;
+    }
+
+    string asString() const {
+        ostringstream oss;
+        forEach([&oss](const K& key, const V& value) { oss << key << ":" << value << ","; });
+        string result = oss.str();
+        if (!result.empty()) {
+            result.pop_back(); // Remove the trailing comma
+        }
+        return result;
+    }
+};
+
+#endif // CONCURRENTHASHTABLE_H
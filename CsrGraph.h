@@ -0,0 +1,770 @@
+#ifndef CSRGRAPH_H
+#define CSRGRAPH_H
+
+#include <algorithm>
+#include <atomic>
+#include <charconv>
+#include <cmath>
+#include <condition_variable>
+#include <cstdint>
+#include <exception>
+#include <functional>
+#include <iostream>
+#include <limits>
+#include <mutex>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+#include "Data Structures/FlatHashTable.h"
+#include "Data Structures/IndexedHeap.h"
+using namespace std;
+
+// Helper threads shared by every parallel traversal in the process. They start on first use,
+// park between jobs, and are lent out whole to one traversal at a time, so the number of
+// threads traversals add stays fixed however many requests run them at once.
+class TraversalHelpers {
+private:
+    static constexpr unsigned MAX_THREADS = 16; // Caller included
+
+    vector<std::thread> helpers;
+    mutex ownerMutex; // Held by the traversal that has the helpers
+    mutex stateMutex;
+    condition_variable wakeup, finished;
+    const function<void(unsigned)>* job = nullptr;
+    unsigned jobThreads = 0; // Workers in the current job, caller included
+    unsigned running = 0;    // Helpers still inside it
+    uint64_t generation = 0; // Bumped for every job
+    bool stopping = false;
+
+    void helperLoop(unsigned worker) {
+        uint64_t seen = 0;
+        unique_lock<mutex> lock(stateMutex);
+        while (true) {
+            wakeup.wait(lock, [&] { return stopping || generation != seen; });
+            if (stopping) return;
+            seen = generation;
+            if (worker >= jobThreads) continue;
+            const function<void(unsigned)>& work = *job;
+            lock.unlock();
+            work(worker);
+            lock.lock();
+            if (--running == 0) finished.notify_one();
+        }
+    }
+
+    TraversalHelpers() {
+        unsigned threads = min(MAX_THREADS, max(1u, std::thread::hardware_concurrency()));
+        for (unsigned worker = 1; worker < threads; ++worker) helpers.emplace_back(&TraversalHelpers::helperLoop, this, worker);
+    }
+
+public:
+    ~TraversalHelpers() {
+        {
+            lock_guard<mutex> lock(stateMutex);
+            stopping = true;
+        }
+        wakeup.notify_all();
+        for (auto& helper : helpers) helper.join();
+    }
+
+    TraversalHelpers(const TraversalHelpers&) = delete;
+    TraversalHelpers& operator=(const TraversalHelpers&) = delete;
+
+    static TraversalHelpers& shared() {
+        static TraversalHelpers instance;
+        return instance;
+    }
+
+    // Most workers a job can have, the caller included
+    unsigned capacity() const {
+        return static_cast<unsigned>(helpers.size()) + 1;
+    }
+
+    // Run work(worker) for every worker below threads, as worker 0 on the calling thread and
+    // the rest on helpers, and return once all have finished. If another traversal has the
+    // helpers, only worker 0 runs, on the calling thread.
+    void run(unsigned threads, const function<void(unsigned)>& work) {
+        unique_lock<mutex> owner(ownerMutex, try_to_lock);
+        threads = min(threads, capacity());
+        if (!owner.owns_lock() || threads <= 1) {
+            work(0);
+            return;
+        }
+        {
+            lock_guard<mutex> lock(stateMutex);
+            job = &work;
+            jobThreads = threads;
+            running = threads - 1;
+            ++generation;
+        }
+        wakeup.notify_all();
+
+        // Helpers still use work and the caller's frame, so wait for them even if worker 0 throws
+        exception_ptr error;
+        try {
+            work(0);
+        } catch (...) {
+            error = current_exception();
+        }
+        unique_lock<mutex> lock(stateMutex);
+        finished.wait(lock, [this] { return running == 0; });
+        job = nullptr;
+        lock.unlock();
+        if (error) rethrow_exception(error);
+    }
+};
+
+// Undirected graph over dense node ids. Each name is interned once into a 32-bit id, and the
+// adjacency lives in compressed sparse rows: every node's neighbour ids sit back to back in one
+// arcs array, so a traversal streams through contiguous memory and marks visits in a bitset
+// instead of hashing names. Edges added since the last compaction wait in a delta buffer
+// (per-node chains in flat arrays) that is folded into the rows once it grows to a quarter of
+// the graph, so adding an edge stays O(1) amortised. Same public API as Graph; as there, an
+// undirected edge is stored as two arcs and a self-loop as two arcs on its node. Edges may
+// carry a non-negative weight (1 by default); weights get their own array, parallel to the
+// arcs, only once some edge weighs something else.
+template <typename T>
+class CsrGraph {
+public:
+    static constexpr uint32_t NO_NODE = UINT32_MAX;
+    static constexpr double UNREACHABLE = numeric_limits<double>::infinity();
+
+private:
+    struct Row {
+        uint64_t begin = 0;    // First arc in arcs
+        uint32_t degree = 0;   // Arcs in use
+        uint32_t capacity = 0; // Arcs reserved; removals leave slack until the next compaction
+    };
+
+    static constexpr size_t MIN_COMPACT_ARCS = 1024;
+    // Smaller graphs are traversed on the calling thread, top-down only, in exact queue order
+    static constexpr size_t PARALLEL_MIN_ARCS = 1 << 16;
+    static constexpr size_t CHUNK_SIZE = 1024; // Nodes a thread claims at a time
+    static constexpr size_t PARALLEL_MIN_CHUNKS = 4; // Smaller levels and passes run serially
+    // Direction-optimizing thresholds (Beamer et al.): go bottom-up once the frontier's arcs
+    // exceed 1/ALPHA of the unvisited arcs, back top-down once it holds under 1/BETA of the nodes
+    static constexpr size_t BFS_ALPHA = 14;
+    static constexpr size_t BFS_BETA = 24;
+
+    vector<T> names;                // id -> name
+    FlatHashTable<T, uint32_t> ids; // name -> id
+    vector<Row> rows;
+    vector<uint32_t> arcs;
+    size_t arcCount = 0; // Live arcs, in the rows and the delta buffer together
+
+    // Delta buffer: arcs added since the last compaction, chained per node in insertion order
+    vector<uint32_t> deltaHead, deltaTail; // Per node; NO_NODE when the chain is empty
+    vector<uint32_t> deltaTarget, deltaNext;
+
+    bool weighted = false;      // Some edge weighs other than 1
+    vector<double> weights;     // Parallel to arcs while weighted
+    vector<double> deltaWeight; // Parallel to deltaTarget while weighted
+
+    // Atomically mark index; true if this call was the one that set it
+    static bool claim(vector<atomic<uint64_t>>& bits, uint32_t index) {
+        uint64_t mask = uint64_t(1) << (index & 63);
+        atomic<uint64_t>& word = bits[index >> 6];
+        if (word.load(memory_order_relaxed) & mask) return false;
+        return !(word.fetch_or(mask, memory_order_relaxed) & mask);
+    }
+
+    static unsigned traversalThreads() {
+        return TraversalHelpers::shared().capacity();
+    }
+
+    // Run body(worker, begin, end) over [0, count) in chunks claimed by up to `threads`
+    // threads, the caller included; worker is a dense index below threads. Work that fits in
+    // a few chunks stays on the calling thread, as does everything while another traversal
+    // has the shared helpers.
+    template <typename Body>
+    static void parallelChunks(size_t count, size_t chunk, unsigned threads, Body body) {
+        atomic<size_t> next(0);
+        function<void(unsigned)> work = [&](unsigned worker) {
+            for (size_t begin; (begin = next.fetch_add(chunk, memory_order_relaxed)) < count;) {
+                body(worker, begin, min(count, begin + chunk));
+            }
+        };
+        if (count < PARALLEL_MIN_CHUNKS * chunk) threads = 1;
+        if (threads <= 1) work(0);
+        else TraversalHelpers::shared().run(static_cast<unsigned>(min<size_t>(threads, (count + chunk - 1) / chunk)), work);
+    }
+
+    // Like forEachNeighbor, but stops at the first neighbour that matches
+    template <typename Predicate>
+    bool anyNeighbor(uint32_t id, Predicate match) const {
+        const Row& row = rows[id];
+        const uint32_t* arc = arcs.data() + row.begin;
+        for (uint32_t i = 0; i < row.degree; ++i) {
+            if (match(arc[i])) return true;
+        }
+        for (uint32_t e = deltaHead[id]; e != NO_NODE; e = deltaNext[e]) {
+            if (match(deltaTarget[e])) return true;
+        }
+        return false;
+    }
+
+    uint32_t intern(const T& name) {
+        const auto* entry = ids.find(name);
+        if (entry) return entry->value;
+        if (names.size() >= NO_NODE) throw length_error("Too many nodes in the graph.");
+        uint32_t id = static_cast<uint32_t>(names.size());
+        ids.insert(name, id);
+        names.push_back(name);
+        rows.emplace_back();
+        deltaHead.push_back(NO_NODE);
+        deltaTail.push_back(NO_NODE);
+        return id;
+    }
+
+    void makeWeighted() {
+        weights.assign(arcs.size(), 1.0);
+        deltaWeight.assign(deltaTarget.size(), 1.0);
+        weighted = true;
+    }
+
+    void appendArc(uint32_t from, uint32_t to, double weight) {
+        Row& row = rows[from];
+        // Slack left by removals is reused only while it keeps the arcs in insertion order
+        if (row.degree < row.capacity && deltaHead[from] == NO_NODE) {
+            if (weighted) weights[row.begin + row.degree] = weight;
+            arcs[row.begin + row.degree++] = to;
+        } else {
+            uint32_t index = static_cast<uint32_t>(deltaTarget.size());
+            deltaTarget.push_back(to);
+            deltaNext.push_back(NO_NODE);
+            if (weighted) deltaWeight.push_back(weight);
+            if (deltaTail[from] == NO_NODE) deltaHead[from] = index;
+            else deltaNext[deltaTail[from]] = index;
+            deltaTail[from] = index;
+        }
+        ++arcCount;
+    }
+
+    // Drop every arc from -> to, keeping the rest in order; the delta buffer must be empty
+    void removeArcs(uint32_t from, uint32_t to) {
+        Row& row = rows[from];
+        uint32_t* arc = arcs.data() + row.begin;
+        double* weight = weighted ? weights.data() + row.begin : nullptr;
+        uint32_t kept = 0;
+        for (uint32_t i = 0; i < row.degree; ++i) {
+            if (arc[i] == to) continue;
+            if (weight) weight[kept] = weight[i];
+            arc[kept++] = arc[i];
+        }
+        arcCount -= row.degree - kept;
+        row.degree = kept;
+    }
+
+    void renumberArcs(uint32_t from, uint32_t oldId, uint32_t newId) {
+        const Row& row = rows[from];
+        uint32_t* arc = arcs.data() + row.begin;
+        for (uint32_t i = 0; i < row.degree; ++i) {
+            if (arc[i] == oldId) arc[i] = newId;
+        }
+    }
+
+    // Compact when the delta buffer or the slack left by removals has grown large
+    void maybeCompact() {
+        size_t threshold = max(MIN_COMPACT_ARCS, arcCount / 4);
+        if (deltaTarget.size() > threshold || arcs.size() > arcCount + threshold) compact();
+    }
+
+public:
+    CsrGraph() {}
+
+    CsrGraph(const CsrGraph&) = delete;
+    CsrGraph& operator=(const CsrGraph&) = delete;
+
+    // Add an edge to the graph
+    void addEdge(const T& u, const T& v, double weight = 1.0) {
+        if (!(weight >= 0 && isfinite(weight))) throw invalid_argument("Edge weights must be finite and non-negative.");
+        if (weight != 1.0 && !weighted) makeWeighted();
+        uint32_t a = intern(u);
+        uint32_t b = intern(v);
+        appendArc(a, b, weight);
+        appendArc(b, a, weight);
+        maybeCompact();
+    }
+
+    // Add a node to the graph
+    void addNode(const T& node) {
+        intern(node);
+    }
+
+    // Remove a node and its edges in O(sum of its neighbours' degrees). Ids stay dense: the
+    // node with the highest id takes over the freed one.
+    void removeNode(const T& node) {
+        const auto* entry = ids.find(node);
+        if (!entry) return;
+        uint32_t id = entry->value;
+        ids.remove(node);
+        if (!deltaTarget.empty()) compact();
+
+        const Row& row = rows[id];
+        for (uint32_t i = 0; i < row.degree; ++i) {
+            uint32_t neighbor = arcs[row.begin + i];
+            if (neighbor != id) removeArcs(neighbor, id);
+        }
+        arcCount -= rows[id].degree;
+
+        uint32_t last = static_cast<uint32_t>(names.size() - 1);
+        if (last != id) {
+            const Row& lastRow = rows[last];
+            for (uint32_t i = 0; i < lastRow.degree; ++i) renumberArcs(arcs[lastRow.begin + i], last, id);
+            rows[id] = rows[last];
+            names[id] = std::move(names[last]);
+            ids.find(names[id])->value = id;
+        }
+        names.pop_back();
+        rows.pop_back();
+        deltaHead.pop_back();
+        deltaTail.pop_back();
+        maybeCompact();
+    }
+
+    // Remove an edge from the graph
+    void removeEdge(const T& u, const T& v) {
+        const auto* first = ids.find(u);
+        const auto* second = ids.find(v);
+        if (!first || !second) return;
+        uint32_t a = first->value;
+        uint32_t b = second->value;
+        if (!deltaTarget.empty()) compact();
+        removeArcs(a, b);
+        if (a != b) removeArcs(b, a);
+    }
+
+    // Rename a node, keeping all of its edges. Only the name table changes unless newName
+    // already exists, in which case the edges are merged into it as Graph does.
+    bool renameNode(const T& oldName, const T& newName) {
+        auto* entry = ids.find(oldName);
+        if (!entry) return false;
+        if (oldName == newName) return true;
+
+        if (!ids.contains(newName)) {
+            uint32_t id = entry->value;
+            ids.remove(oldName);
+            ids.insert(newName, id);
+            names[id] = newName;
+            return true;
+        }
+
+        T removed = oldName; // oldName may refer into names, which removeNode reshuffles
+        uint32_t id = entry->value;
+        vector<pair<T, double>> neighbors;
+        forEachArc(id, [&](uint32_t neighbor, double weight) { neighbors.emplace_back(names[neighbor], weight); });
+        removeNode(removed);
+        bool pendingSelfLoop = false;
+        for (const auto& neighbor : neighbors) {
+            if (neighbor.first != removed) {
+                addEdge(newName, neighbor.first, neighbor.second);
+            } else if ((pendingSelfLoop = !pendingSelfLoop)) {
+                addEdge(newName, newName, neighbor.second); // Self-loops are listed twice; re-add once
+            }
+        }
+        return true;
+    }
+
+    // Fold the delta buffer and any slack into freshly packed rows, O(nodes + edges)
+    void compact() {
+        vector<uint32_t> packed;
+        vector<double> packedWeights;
+        packed.reserve(arcCount);
+        if (weighted) packedWeights.reserve(arcCount);
+        for (uint32_t id = 0; id < rows.size(); ++id) {
+            uint64_t begin = packed.size();
+            forEachArc(id, [&](uint32_t neighbor, double weight) {
+                packed.push_back(neighbor);
+                if (weighted) packedWeights.push_back(weight);
+            });
+            Row& row = rows[id];
+            row.begin = begin;
+            row.degree = row.capacity = static_cast<uint32_t>(packed.size() - begin);
+        }
+        arcs.swap(packed);
+        weights.swap(packedWeights);
+        fill(deltaHead.begin(), deltaHead.end(), NO_NODE);
+        fill(deltaTail.begin(), deltaTail.end(), NO_NODE);
+        deltaTarget.clear();
+        deltaNext.clear();
+        deltaWeight.clear();
+    }
+
+    // Replace the contents with nodes whose neighbour ids are targets[offsets[i], offsets[i + 1]),
+    // and their weights arcWeights[...] (empty if every edge weighs 1), taking the arrays over
+    // without copying. The caller has checked the offsets, ids and weights; returns false
+    // (leaving the graph empty) if a name repeats.
+    bool assign(vector<T> nodeNames, const vector<uint64_t>& offsets, vector<uint32_t> targets,
+                vector<double> arcWeights = vector<double>()) {
+        clear();
+        if (nodeNames.size() >= NO_NODE) return false;
+        uint32_t nodeCount = static_cast<uint32_t>(nodeNames.size());
+        rows.resize(nodeCount);
+        for (uint32_t id = 0; id < nodeCount; ++id) {
+            uint64_t degree = offsets[id + 1] - offsets[id];
+            if (ids.contains(nodeNames[id]) || degree >= NO_NODE) {
+                clear();
+                return false;
+            }
+            ids.insert(nodeNames[id], id);
+            rows[id].begin = offsets[id];
+            rows[id].degree = rows[id].capacity = static_cast<uint32_t>(degree);
+            arcCount += degree;
+        }
+        names = std::move(nodeNames);
+        arcs = std::move(targets);
+        weighted = !arcWeights.empty();
+        weights = std::move(arcWeights);
+        deltaHead.assign(nodeCount, NO_NODE);
+        deltaTail.assign(nodeCount, NO_NODE);
+        return true;
+    }
+
+    // The inverse of assign: packed offsets and neighbour ids, with node i named nodeName(i),
+    // and the weights if arcWeights is given and the graph is weighted
+    void exportRows(vector<uint64_t>& offsets, vector<uint32_t>& targets, vector<double>* arcWeights = nullptr) const {
+        offsets.clear();
+        targets.clear();
+        offsets.reserve(names.size() + 1);
+        targets.reserve(arcCount);
+        bool withWeights = arcWeights && weighted;
+        if (arcWeights) arcWeights->clear();
+        if (withWeights) arcWeights->reserve(arcCount);
+        offsets.push_back(0);
+        for (uint32_t id = 0; id < names.size(); ++id) {
+            forEachArc(id, [&](uint32_t neighbor, double weight) {
+                targets.push_back(neighbor);
+                if (withWeights) arcWeights->push_back(weight);
+            });
+            offsets.push_back(targets.size());
+        }
+    }
+
+    bool isWeighted() const { return weighted; }
+
+    // Pre-size the node table before a bulk load
+    void reserve(size_t nodeCount) {
+        names.reserve(nodeCount);
+        rows.reserve(nodeCount);
+        deltaHead.reserve(nodeCount);
+        deltaTail.reserve(nodeCount);
+    }
+
+    void clear() {
+        names.clear();
+        ids.clear();
+        rows.clear();
+        vector<uint32_t>().swap(arcs);
+        arcCount = 0;
+        deltaHead.clear();
+        deltaTail.clear();
+        vector<uint32_t>().swap(deltaTarget);
+        vector<uint32_t>().swap(deltaNext);
+        weighted = false;
+        vector<double>().swap(weights);
+        vector<double>().swap(deltaWeight);
+    }
+
+    /// Id-level access for the traversal algorithms
+
+    // The id of node, or NO_NODE if it isn't in the graph
+    uint32_t findNode(const T& node) const {
+        const auto* entry = ids.find(node);
+        return entry ? entry->value : NO_NODE;
+    }
+
+    const T& nodeName(uint32_t id) const { return names[id]; }
+
+    // Visit the neighbour ids of node id in insertion order
+    template <typename Visitor>
+    void forEachNeighbor(uint32_t id, Visitor visit) const {
+        const Row& row = rows[id];
+        const uint32_t* arc = arcs.data() + row.begin;
+        for (uint32_t i = 0; i < row.degree; ++i) visit(arc[i]);
+        for (uint32_t e = deltaHead[id]; e != NO_NODE; e = deltaNext[e]) visit(deltaTarget[e]);
+    }
+
+    // Visit the neighbour ids of node id with the weight of each edge
+    template <typename Visitor>
+    void forEachArc(uint32_t id, Visitor visit) const {
+        if (!weighted) {
+            forEachNeighbor(id, [&visit](uint32_t neighbor) { visit(neighbor, 1.0); });
+            return;
+        }
+        const Row& row = rows[id];
+        for (uint64_t i = row.begin; i < row.begin + row.degree; ++i) visit(arcs[i], weights[i]);
+        for (uint32_t e = deltaHead[id]; e != NO_NODE; e = deltaNext[e]) visit(deltaTarget[e], deltaWeight[e]);
+    }
+
+    size_t degree(uint32_t id) const {
+        size_t count = rows[id].degree;
+        for (uint32_t e = deltaHead[id]; e != NO_NODE; e = deltaNext[e]) ++count;
+        return count;
+    }
+
+    // Node ids in breadth-first order from source. The search is level-synchronous and
+    // direction-optimizing: a level is expanded top-down (frontier nodes claim unvisited
+    // neighbours) while the frontier is small, and bottom-up (each unvisited node looks for a
+    // neighbour in the frontier bitset, stopping at the first) once the frontier carries a large
+    // share of the remaining arcs, which skips most edge checks in the wide middle levels of a
+    // social graph. Each level is split across threads, so nodes within a level come in no
+    // particular order on large graphs. levelStarts, if given, receives where each level begins;
+    // the search stops after maxDepth levels (hops from source).
+    vector<uint32_t> bfsOrder(uint32_t source, vector<size_t>* levelStarts = nullptr, size_t maxDepth = SIZE_MAX) const {
+        size_t nodeCount = names.size();
+        size_t words = (nodeCount + 63) / 64;
+        bool large = arcCount >= PARALLEL_MIN_ARCS;
+        unsigned threads = large ? traversalThreads() : 1;
+
+        vector<atomic<uint64_t>> visited(words);
+        vector<uint64_t> frontierBits;
+        vector<vector<uint32_t>> found(threads);
+        vector<size_t> foundArcs(threads);
+        vector<uint32_t> order{source};
+        vector<size_t> starts{0};
+        claim(visited, source);
+
+        size_t frontierBegin = 0;
+        size_t frontierArcs = degree(source);
+        size_t unvisitedArcs = arcCount - frontierArcs;
+        bool bottomUp = false;
+        while (frontierBegin < order.size() && starts.size() <= maxDepth) {
+            size_t frontierSize = order.size() - frontierBegin;
+            if (large && !bottomUp && frontierArcs > unvisitedArcs / BFS_ALPHA) bottomUp = true;
+            else if (bottomUp && frontierSize < nodeCount / BFS_BETA) bottomUp = false;
+
+            for (auto& list : found) list.clear();
+            fill(foundArcs.begin(), foundArcs.end(), 0);
+            if (bottomUp) {
+                frontierBits.assign(words, 0);
+                for (size_t i = frontierBegin; i < order.size(); ++i) frontierBits[order[i] >> 6] |= uint64_t(1) << (order[i] & 63);
+                auto inFrontier = [&frontierBits](uint32_t id) { return (frontierBits[id >> 6] >> (id & 63)) & 1; };
+                // Chunks are whole bitset words, so each word of visited has a single writer
+                parallelChunks(words, CHUNK_SIZE / 64, threads, [&](unsigned worker, size_t begin, size_t end) {
+                    for (size_t w = begin; w < end; ++w) {
+                        uint64_t pending = ~visited[w].load(memory_order_relaxed);
+                        if (w == words - 1 && nodeCount % 64) pending &= (uint64_t(1) << (nodeCount % 64)) - 1;
+                        uint64_t reached = 0;
+                        for (; pending; pending &= pending - 1) {
+                            uint32_t id = static_cast<uint32_t>(w * 64 + __builtin_ctzll(pending));
+                            if (!anyNeighbor(id, inFrontier)) continue;
+                            reached |= pending & -pending;
+                            found[worker].push_back(id);
+                            foundArcs[worker] += degree(id);
+                        }
+                        if (reached) visited[w].fetch_or(reached, memory_order_relaxed);
+                    }
+                });
+            } else {
+                parallelChunks(frontierSize, CHUNK_SIZE, threads, [&](unsigned worker, size_t begin, size_t end) {
+                    for (size_t i = frontierBegin + begin; i < frontierBegin + end; ++i) {
+                        forEachNeighbor(order[i], [&](uint32_t neighbor) {
+                            if (!claim(visited, neighbor)) return;
+                            found[worker].push_back(neighbor);
+                            foundArcs[worker] += degree(neighbor);
+                        });
+                    }
+                });
+            }
+
+            frontierBegin = order.size();
+            frontierArcs = 0;
+            for (unsigned worker = 0; worker < threads; ++worker) {
+                order.insert(order.end(), found[worker].begin(), found[worker].end());
+                frontierArcs += foundArcs[worker];
+            }
+            unvisitedArcs -= frontierArcs;
+            if (order.size() > frontierBegin) starts.push_back(frontierBegin);
+        }
+        if (levelStarts) *levelStarts = std::move(starts);
+        return order;
+    }
+
+    // Connected components by concurrent union-find: each edge links the roots of its two ends,
+    // the larger root under the smaller with a compare-and-swap, and every find halves the path
+    // it walks. Parents only ever move to smaller ids, so racing links and halvings cannot form
+    // a cycle, and nodes are split across threads. Returns, for each id, the smallest id in its
+    // component.
+    vector<uint32_t> componentLabels() const {
+        size_t nodeCount = names.size();
+        unsigned threads = arcCount >= PARALLEL_MIN_ARCS ? traversalThreads() : 1;
+        vector<atomic<uint32_t>> parent(nodeCount);
+        for (uint32_t id = 0; id < nodeCount; ++id) parent[id].store(id, memory_order_relaxed);
+
+        auto find = [&parent](uint32_t id) {
+            while (true) {
+                uint32_t up = parent[id].load(memory_order_relaxed);
+                if (up == id) return id;
+                uint32_t grandparent = parent[up].load(memory_order_relaxed);
+                if (grandparent != up) parent[id].compare_exchange_weak(up, grandparent, memory_order_relaxed);
+                id = grandparent;
+            }
+        };
+        auto unite = [&](uint32_t a, uint32_t b) {
+            while (true) {
+                a = find(a);
+                b = find(b);
+                if (a == b) return;
+                if (a < b) swap(a, b);
+                uint32_t root = a;
+                if (parent[a].compare_exchange_strong(root, b, memory_order_relaxed)) return;
+            }
+        };
+
+        parallelChunks(nodeCount, CHUNK_SIZE, threads, [&](unsigned, size_t begin, size_t end) {
+            for (uint32_t id = static_cast<uint32_t>(begin); id < end; ++id) {
+                // Both arcs of an edge are stored; the one from the smaller end is enough
+                forEachNeighbor(id, [&](uint32_t neighbor) {
+                    if (neighbor > id) unite(id, neighbor);
+                });
+            }
+        });
+
+        vector<uint32_t> labels(nodeCount);
+        parallelChunks(nodeCount, CHUNK_SIZE, threads, [&](unsigned, size_t begin, size_t end) {
+            for (size_t id = begin; id < end; ++id) labels[id] = find(static_cast<uint32_t>(id));
+        });
+        return labels;
+    }
+
+    // Cheapest path from source to target by A*: nodes are settled in order of their distance
+    // so far plus heuristic(id), which must never overestimate the distance left (a zero
+    // heuristic makes this Dijkstra). Open nodes sit in an IndexedHeap keyed by id, so finding
+    // a shorter way to one is an O(log n) decrease-key rather than a duplicate entry, and the
+    // search stops as soon as target is settled. Returns the distance, or UNREACHABLE, and
+    // fills path with the ids from source to target.
+    template <typename Heuristic>
+    double shortestPath(uint32_t source, uint32_t target, vector<uint32_t>& path, Heuristic heuristic) const {
+        path.clear();
+        vector<double> distance(names.size(), UNREACHABLE);
+        vector<uint32_t> previous(names.size(), NO_NODE);
+        IndexedHeap<uint32_t, double, greater<double>> open;
+        distance[source] = 0;
+        open.push(source, heuristic(source));
+        while (!open.isEmpty()) {
+            uint32_t id = open.pop().key;
+            if (id == target) break;
+            forEachArc(id, [&](uint32_t neighbor, double weight) {
+                double candidate = distance[id] + weight;
+                if (candidate >= distance[neighbor]) return;
+                distance[neighbor] = candidate;
+                previous[neighbor] = id;
+                open.pushOrUpdate(neighbor, candidate + heuristic(neighbor));
+            });
+        }
+        if (distance[target] == UNREACHABLE) return UNREACHABLE;
+        for (uint32_t id = target; id != NO_NODE; id = previous[id]) path.push_back(id);
+        reverse(path.begin(), path.end());
+        return distance[target];
+    }
+
+    double shortestPath(uint32_t source, uint32_t target, vector<uint32_t>& path) const {
+        return shortestPath(source, target, path, [](uint32_t) { return 0.0; });
+    }
+
+    /// Graph-compatible API
+
+    // Display the adjacency list representation of the graph
+    void display() const {
+        cout << asString();
+    }
+
+    // Perform BFS traversal from a given start node
+    void bfs(const T& start) const {
+        cout << bfsAsString(start) << endl;
+    }
+
+    // Perform BFS traversal and return the result as a string
+    string bfsAsString(const T& start) const {
+        uint32_t source = findNode(start);
+        if (source == NO_NODE) throw invalid_argument("Start node not found in the graph.");
+        ostringstream result;
+        for (uint32_t id : bfsOrder(source)) result << names[id] << " ";
+        return result.str();
+    }
+
+    // Check if a node exists in the graph
+    bool containsNode(const T& node) const {
+        return ids.contains(node);
+    }
+
+    // Get the neighbors of a given node
+    vector<T> getNeighbors(const T& node) const {
+        uint32_t id = findNode(node);
+        if (id == NO_NODE) throw invalid_argument("Node not found in the graph.");
+        vector<T> neighbors;
+        forEachNeighbor(id, [&](uint32_t neighbor) { neighbors.push_back(names[neighbor]); });
+        return neighbors;
+    }
+
+    // Get the size of the graph (number of nodes)
+    size_t size() const {
+        return names.size();
+    }
+
+    // Number of undirected edges, self-loops included
+    size_t edgeCount() const {
+        return arcCount / 2;
+    }
+
+    // Check if the graph is connected
+    bool isConnected() const {
+        if (names.empty()) return true;
+        return bfsOrder(0).size() == names.size();
+    }
+
+    // Get all nodes in the graph, in id order
+    vector<T> getNodes() const {
+        return names;
+    }
+
+    // Shortest text that reads back as the same double
+    static string formatWeight(double weight) {
+        char buffer[32];
+        return string(buffer, to_chars(buffer, buffer + sizeof(buffer), weight).ptr);
+    }
+
+    // A name like "B:5" would read back as node B with weight 5 unless its weight is spelled out
+    static bool hasColon(const string& name) { return name.find(':') != string::npos; }
+    template <typename Name>
+    static bool hasColon(const Name&) { return false; }
+
+    // Return the edges in the node1-node2,node3-node4:weight format accepted by ADD_DATA
+    string edgesAsString() const {
+        ostringstream oss;
+        bool first = true;
+        for (uint32_t id = 0; id < names.size(); ++id) {
+            size_t selfLoops = 0;
+            forEachArc(id, [&](uint32_t neighbor, double weight) {
+                // Each undirected edge is stored twice; emit it from its smaller id only
+                if (neighbor < id) return;
+                if (neighbor == id && selfLoops++ % 2 == 1) return;
+                if (!first) oss << ",";
+                oss << names[id] << "-" << names[neighbor];
+                if (weight != 1.0 || hasColon(names[neighbor])) oss << ":" << formatWeight(weight);
+                first = false;
+            });
+        }
+        return oss.str();
+    }
+
+    // Return the graph as a string
+    string asString() const {
+        ostringstream oss;
+        for (uint32_t id = 0; id < names.size(); ++id) {
+            oss << names[id] << ": ";
+            forEachArc(id, [&](uint32_t neighbor, double weight) {
+                oss << names[neighbor];
+                if (weight != 1.0) oss << ":" << formatWeight(weight);
+                oss << " ";
+            });
+            oss << "\n";
+        }
+        return oss.str();
+    }
+};
+
+#endif // CSRGRAPH_H
@@ -0,0 +1,143 @@
+#ifndef DARYHEAP_H
+#define DARYHEAP_H
+
+#include <algorithm>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+using namespace std;
+
+// Implicit max-heap where every node has D children. A wider node makes the tree
+// log2(D) times shallower, and the D children are adjacent in the array (one cache line
+// for D = 4 or 8 ints), so a sift-down pays for far fewer cache misses on large heaps
+// than the binary layout, at the price of D - 1 comparisons per level.
+template <typename T, size_t D = 4>
+class DaryHeap {
+    static_assert(D >= 2, "A heap node needs at least two children.");
+
+private:
+    vector<T> heap;
+
+    static size_t parentOf(size_t index) { return (index - 1) / D; }
+    static size_t firstChildOf(size_t index) { return index * D + 1; }
+
+    // Both sifts carry the moving value and shift the others over the hole
+    void siftUp(size_t index) {
+        T moving = std::move(heap[index]);
+        while (index > 0 && heap[parentOf(index)] < moving) {
+            heap[index] = std::move(heap[parentOf(index)]);
+            index = parentOf(index);
+        }
+        heap[index] = std::move(moving);
+    }
+
+    void siftDown(size_t index) {
+        T moving = std::move(heap[index]);
+        size_t size = heap.size();
+        while (true) {
+            size_t first = firstChildOf(index);
+            if (first >= size) break;
+            size_t last = min(first + D, size);
+            size_t largest = first;
+            for (size_t child = first + 1; child < last; ++child) {
+                if (heap[largest] < heap[child]) largest = child;
+            }
+            if (!(moving < heap[largest])) break;
+            heap[index] = std::move(heap[largest]);
+            index = largest;
+        }
+        heap[index] = std::move(moving);
+    }
+
+public:
+    void insert(const T& value) {
+        heap.push_back(value);
+        siftUp(heap.size() - 1);
+    }
+
+    T extractMax() {
+        if (heap.empty()) throw underflow_error("Heap is empty.");
+        T maxVal = std::move(heap[0]);
+        heap[0] = std::move(heap.back());
+        heap.pop_back();
+        if (!heap.empty()) siftDown(0);
+        return maxVal;
+    }
+
+    T findMax() const {
+        if (heap.empty()) throw underflow_error("Heap is empty.");
+        return heap[0];
+    }
+
+    // Remove one copy of value. Finding it is a linear scan; the repair is O(log n).
+    void remove(const T& value) {
+        auto it = find(heap.begin(), heap.end(), value);
+        if (it == heap.end()) throw invalid_argument("Value not found in heap.");
+
+        size_t index = it - heap.begin();
+        heap[index] = std::move(heap.back());
+        heap.pop_back();
+        if (index == heap.size()) return;
+        // The moved value may belong above or below the hole
+        if (index > 0 && heap[parentOf(index)] < heap[index]) siftUp(index);
+        else siftDown(index);
+    }
+
+    size_t getSize() const { return heap.size(); }
+
+    bool isEmpty() const { return heap.empty(); }
+
+    void clear() { heap.clear(); }
+
+    // Replace the contents with elements (any order) in O(n)
+    void buildHeap(const vector<T>& elements) {
+        heap = elements;
+        if (heap.size() < 2) return;
+        for (size_t i = parentOf(heap.size() - 1) + 1; i-- > 0;) siftDown(i);
+    }
+
+    // The k largest values, largest first, without changing the heap; O(k D log k)
+    vector<T> topK(size_t k) const {
+        vector<T> best;
+        if (heap.empty() || k == 0) return best;
+        auto below = [this](size_t a, size_t b) { return heap[a] < heap[b]; };
+        vector<size_t> frontier{0};
+        while (!frontier.empty() && best.size() < k) {
+            pop_heap(frontier.begin(), frontier.end(), below);
+            size_t index = frontier.back();
+            frontier.pop_back();
+            best.push_back(heap[index]);
+            size_t first = firstChildOf(index);
+            for (size_t child = first; child < first + D && child < heap.size(); ++child) {
+                frontier.push_back(child);
+                push_heap(frontier.begin(), frontier.end(), below);
+            }
+        }
+        return best;
+    }
+
+    // All values, largest first; the heap is left as it is
+    vector<T> heapSort() const {
+        vector<T> sorted(heap);
+        sort(sorted.begin(), sorted.end(), [](const T& a, const T& b) { return b < a; });
+        return sorted;
+    }
+
+    // Get the underlying array in heap order
+    vector<T> toVector() const { return heap; }
+
+    void display() const {
+        for (const auto& val : heap) cout << val << " ";
+        cout << endl;
+    }
+
+    string asString() const {
+        string result = "[ ";
+        for (const auto& val : heap) result += to_string(val) + " ";
+        result += "]";
+        return result;
+    }
+};
+
+#endif // DARYHEAP_H
@@ -0,0 +1,439 @@
+#ifndef FLATHASHTABLE_H
+#define FLATHASHTABLE_H
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <iostream>
+#include <new>
+#include <sstream>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+using namespace std;
+
+// How a FlatHashTable grows once it passes its load limit
+enum class ResizeMode {
+    StopTheWorld, // Rehash every entry into the new arrays during the insert that triggers it
+    Incremental   // Move a group of old slots per insert/remove; lookups check both tables meanwhile
+};
+
+struct HashTableStats {
+    ResizeMode mode;
+    size_t size;
+    size_t capacity;     // Slots in the current (new, while resizing) table
+    bool resizing;
+    size_t pendingSlots; // Old-table slots still waiting to be migrated
+    size_t resizeCount;  // Resizes started over the table's lifetime
+    size_t tombstones;
+};
+
+// Open-addressing hash table in the Swiss-table style: a parallel array of one-byte control
+// codes (empty, deleted, or 7 bits of the key's hash) is scanned 16 slots at a time with SSE2,
+// so most lookups touch one control group and one slot instead of chasing list nodes.
+// Drop-in replacement for HashTable with the same public API. In ResizeMode::Incremental a resize
+// only allocates the new arrays; the old ones are drained a group per insert/remove, so no single
+// operation pays for moving the whole table.
+template <typename K, typename V, typename Hash = std::hash<K>>
+class FlatHashTable {
+public:
+    struct Entry {
+        K key;
+        V value;
+        Entry(const K& k, const V& v) : key(k), value(v) {}
+    };
+
+private:
+    static const size_t GROUP_WIDTH = 16;
+    static const int8_t CTRL_EMPTY = -128;  // 0b10000000
+    static const int8_t CTRL_DELETED = -2;  // 0b11111110
+    // Full slots hold the low 7 bits of the hash (0..127), so "is full" is just "sign bit clear"
+
+    // Old slots migrated per insert/remove while resizing. A resize leaves the new table room for
+    // at least 3/8 of its capacity in inserts, far more than the capacity/16 steps the move
+    // takes, so migration always finishes before the next resize is due.
+    static const size_t MIGRATE_SLOTS_PER_STEP = GROUP_WIDTH;
+
+    int8_t* ctrl;
+    Entry* slots;
+    size_t capacity;   // Always a power of two and a multiple of GROUP_WIDTH
+    size_t size;
+    size_t tombstones; // Deleted slots still counted against the load factor
+    Hash hashFunc;
+
+    ResizeMode resizeMode;
+    int8_t* oldCtrl;      // Non-null only while an incremental resize is in progress
+    Entry* oldSlots;
+    size_t oldCapacity;
+    size_t oldSize;       // Entries still in the old table
+    size_t migrateCursor; // Old slots below this index have been moved already
+    size_t resizeCount;
+
+    // Spread the hash so identity hashes (e.g. std::hash<int>) still fill the control bits
+    size_t mixedHash(const K& key) const {
+        uint64_t h = static_cast<uint64_t>(hashFunc(key));
+        h ^= h >> 33;
+        h *= 0xff51afd7ed558ccdULL;
+        h ^= h >> 33;
+        return static_cast<size_t>(h);
+    }
+
+    static int8_t h2(size_t hash) { return static_cast<int8_t>(hash & 0x7F); }
+    size_t groupCount() const { return capacity / GROUP_WIDTH; }
+
+    // Bitmask of slots in the group whose control byte equals value
+    static uint32_t matchByte(const int8_t* group, int8_t value) {
+#ifdef __SSE2__
+        __m128i ctrlBytes = _mm_loadu_si128(reinterpret_cast<const __m128i*>(group));
+        return static_cast<uint32_t>(_mm_movemask_epi8(_mm_cmpeq_epi8(ctrlBytes, _mm_set1_epi8(value))));
+#else
+        uint32_t mask = 0;
+        for (size_t i = 0; i < GROUP_WIDTH; ++i) {
+            if (group[i] == value) mask |= 1u << i;
+        }
+        return mask;
+#endif
+    }
+
+    // Bitmask of empty or deleted slots (the only control bytes with the sign bit set)
+    static uint32_t matchFree(const int8_t* group) {
+#ifdef __SSE2__
+        __m128i ctrlBytes = _mm_loadu_si128(reinterpret_cast<const __m128i*>(group));
+        return static_cast<uint32_t>(_mm_movemask_epi8(ctrlBytes));
+#else
+        uint32_t mask = 0;
+        for (size_t i = 0; i < GROUP_WIDTH; ++i) {
+            if (group[i] < 0) mask |= 1u << i;
+        }
+        return mask;
+#endif
+    }
+
+    static int lowestBit(uint32_t mask) { return __builtin_ctz(mask); }
+
+    // Slot index of key in one table's arrays, or tableCapacity if absent. Probes whole groups in
+    // triangular order and stops at the first group that still has an empty slot.
+    size_t findIndexIn(const int8_t* tableCtrl, const Entry* tableSlots, size_t tableCapacity, const K& key,
+                       size_t hash) const {
+        size_t groups = tableCapacity / GROUP_WIDTH;
+        size_t mask = groups - 1;
+        size_t group = (hash >> 7) & mask;
+        int8_t tag = h2(hash);
+        for (size_t step = 1; step <= groups; ++step) {
+            const int8_t* groupCtrl = tableCtrl + group * GROUP_WIDTH;
+            for (uint32_t match = matchByte(groupCtrl, tag); match; match &= match - 1) {
+                size_t index = group * GROUP_WIDTH + lowestBit(match);
+                if (tableSlots[index].key == key) return index;
+            }
+            if (matchByte(groupCtrl, CTRL_EMPTY)) return tableCapacity;
+            group = (group + step) & mask;
+        }
+        return tableCapacity;
+    }
+
+    size_t findIndex(const K& key, size_t hash) const {
+        return findIndexIn(ctrl, slots, capacity, key, hash);
+    }
+
+    // Entry for key in the current table or, mid-resize, the old one; nullptr if absent
+    Entry* locate(const K& key, size_t hash) const {
+        size_t index = findIndex(key, hash);
+        if (index != capacity) return &slots[index];
+        if (oldCtrl) {
+            index = findIndexIn(oldCtrl, oldSlots, oldCapacity, key, hash);
+            if (index != oldCapacity) return &oldSlots[index];
+        }
+        return nullptr;
+    }
+
+    // First empty or deleted slot on key's probe sequence
+    size_t findFreeIndex(size_t hash) const {
+        size_t mask = groupCount() - 1;
+        size_t group = (hash >> 7) & mask;
+        for (size_t step = 1;; ++step) {
+            uint32_t freeSlots = matchFree(ctrl + group * GROUP_WIDTH);
+            if (freeSlots) return group * GROUP_WIDTH + lowestBit(freeSlots);
+            group = (group + step) & mask;
+        }
+    }
+
+    // Fresh current-table arrays; size is left to the caller, since mid-resize it spans both tables
+    void allocate(size_t cap) {
+        capacity = cap;
+        ctrl = new int8_t[capacity];
+        memset(ctrl, CTRL_EMPTY, capacity);
+        slots = static_cast<Entry*>(::operator new(capacity * sizeof(Entry)));
+        tombstones = 0;
+    }
+
+    // Claim a free slot for hash in the current table and tag it
+    size_t claimSlot(size_t hash) {
+        size_t index = findFreeIndex(hash);
+        if (ctrl[index] == CTRL_DELETED) --tombstones;
+        ctrl[index] = h2(hash);
+        return index;
+    }
+
+    void destroyAll() {
+        for (size_t i = 0; i < capacity; ++i) {
+            if (ctrl[i] >= 0) slots[i].~Entry();
+        }
+    }
+
+    void releaseOld() {
+        if (!oldCtrl) return;
+        for (size_t i = migrateCursor; i < oldCapacity; ++i) {
+            if (oldCtrl[i] >= 0) oldSlots[i].~Entry();
+        }
+        delete[] oldCtrl;
+        ::operator delete(oldSlots);
+        oldCtrl = nullptr;
+        oldSlots = nullptr;
+        oldCapacity = 0;
+        oldSize = 0;
+        migrateCursor = 0;
+    }
+
+    void release() {
+        releaseOld();
+        destroyAll();
+        delete[] ctrl;
+        ::operator delete(slots);
+    }
+
+    // Visit every full slot of both tables
+    template <typename Visitor>
+    void forEachEntry(Visitor visit) const {
+        for (size_t i = 0; i < capacity; ++i) {
+            if (ctrl[i] >= 0) visit(slots[i]);
+        }
+        for (size_t i = migrateCursor; i < oldCapacity; ++i) {
+            if (oldCtrl[i] >= 0) visit(oldSlots[i]);
+        }
+    }
+
+    static size_t roundCapacity(size_t cap) {
+        size_t rounded = GROUP_WIDTH;
+        while (rounded < cap) rounded *= 2;
+        return rounded;
+    }
+
+    // Grow when live entries pass 7/8 of the slots; otherwise rebuild in place to purge tombstones
+    void rehash(size_t newCapacity) {
+        int8_t* previousCtrl = ctrl;
+        Entry* previousSlots = slots;
+        size_t previousCapacity = capacity;
+
+        allocate(newCapacity);
+        for (size_t i = 0; i < previousCapacity; ++i) {
+            if (previousCtrl[i] < 0) continue;
+            size_t index = claimSlot(mixedHash(previousSlots[i].key));
+            new (&slots[index]) Entry(std::move(previousSlots[i]));
+            previousSlots[i].~Entry();
+        }
+        delete[] previousCtrl;
+        ::operator delete(previousSlots);
+    }
+
+    // Incremental mode: keep the old arrays aside and start filling fresh ones
+    void startResize(size_t newCapacity) {
+        oldCtrl = ctrl;
+        oldSlots = slots;
+        oldCapacity = capacity;
+        oldSize = size;
+        migrateCursor = 0;
+        allocate(newCapacity);
+    }
+
+    // Move up to count old slots into the current table; frees the old arrays once drained
+    void migrate(size_t count) {
+        size_t end = min(oldCapacity, migrateCursor + count);
+        for (; migrateCursor < end && oldSize > 0; ++migrateCursor) {
+            if (oldCtrl[migrateCursor] < 0) continue;
+            Entry& entry = oldSlots[migrateCursor];
+            size_t index = claimSlot(mixedHash(entry.key));
+            new (&slots[index]) Entry(std::move(entry));
+            entry.~Entry();
+            // A tombstone, not empty: probes for keys still in the old table must run past it
+            oldCtrl[migrateCursor] = CTRL_DELETED;
+            --oldSize;
+        }
+        if (oldSize == 0) releaseOld();
+    }
+
+    void reserveForInsert() {
+        if (oldCtrl) {
+            migrate(MIGRATE_SLOTS_PER_STEP);
+            // Unreachable by the sizing above, but never let the new table overfill mid-move
+            if (oldCtrl && (size - oldSize + tombstones + 1) * 8 > capacity * 7) migrate(oldCapacity);
+        }
+        size_t live = size - oldSize;
+        if ((live + tombstones + 1) * 8 <= capacity * 7) return;
+
+        size_t newCapacity = live * 2 >= capacity ? capacity * 2 : capacity;
+        ++resizeCount;
+        if (resizeMode == ResizeMode::Incremental) {
+            startResize(newCapacity);
+            migrate(MIGRATE_SLOTS_PER_STEP);
+        } else {
+            rehash(newCapacity);
+        }
+    }
+
+    Entry* insertNew(const K& key, const V& value, size_t hash) {
+        reserveForInsert();
+        size_t index = claimSlot(hash);
+        new (&slots[index]) Entry(key, value);
+        ++size;
+        return &slots[index];
+    }
+
+public:
+    FlatHashTable(size_t cap = 16, Hash hashFunc = Hash())
+        : size(0), hashFunc(hashFunc), resizeMode(ResizeMode::StopTheWorld), oldCtrl(nullptr), oldSlots(nullptr),
+          oldCapacity(0), oldSize(0), migrateCursor(0), resizeCount(0) {
+        // Keep cap entries under the 7/8 load limit
+        allocate(roundCapacity(cap + cap / 7 + 1));
+    }
+
+    ~FlatHashTable() { release(); }
+
+    FlatHashTable(const FlatHashTable&) = delete;
+    FlatHashTable& operator=(const FlatHashTable&) = delete;
+
+    // Switching to StopTheWorld finishes any resize in progress
+    void setResizeMode(ResizeMode mode) {
+        if (mode == ResizeMode::StopTheWorld && oldCtrl) migrate(oldCapacity);
+        resizeMode = mode;
+    }
+
+    // Grow up front so count entries fit without another resize
+    void reserve(size_t count) {
+        if (oldCtrl) migrate(oldCapacity);
+        size_t wanted = roundCapacity(count + count / 7 + 1);
+        if (wanted > capacity) rehash(wanted);
+    }
+
+    void insert(const K& key, const V& value) {
+        size_t hash = mixedHash(key);
+        Entry* entry = locate(key, hash);
+        if (entry) {
+            entry->value = value;
+            return;
+        }
+        insertNew(key, value, hash);
+    }
+
+    void remove(const K& key) {
+        size_t hash = mixedHash(key);
+        size_t index = findIndex(key, hash);
+        if (index != capacity) {
+            slots[index].~Entry();
+            // A group that still has an empty slot ends every probe that reaches it, so the
+            // freed slot can go straight back to empty instead of becoming a tombstone
+            const int8_t* groupCtrl = ctrl + (index / GROUP_WIDTH) * GROUP_WIDTH;
+            if (matchByte(groupCtrl, CTRL_EMPTY)) {
+                ctrl[index] = CTRL_EMPTY;
+            } else {
+                ctrl[index] = CTRL_DELETED;
+                ++tombstones;
+            }
+        } else {
+            size_t oldIndex = oldCtrl ? findIndexIn(oldCtrl, oldSlots, oldCapacity, key, hash) : oldCapacity;
+            if (oldIndex == oldCapacity) throw invalid_argument("Key not found.");
+            oldSlots[oldIndex].~Entry();
+            oldCtrl[oldIndex] = CTRL_DELETED;
+            --oldSize;
+        }
+        --size;
+        if (oldCtrl) migrate(MIGRATE_SLOTS_PER_STEP);
+    }
+
+    V get(const K& key) const {
+        Entry* entry = locate(key, mixedHash(key));
+        if (!entry) throw invalid_argument("Key not found.");
+        return entry->value;
+    }
+
+    bool contains(const K& key) const {
+        return locate(key, mixedHash(key)) != nullptr;
+    }
+
+    void display() const {
+        forEachEntry([](const Entry& entry) { cout << "[" << entry.key << ": " << entry.value << "]" << endl; });
+    }
+
+    size_t getSize() const {
+        return size;
+    }
+
+    size_t getCapacity() const {
+        return capacity;
+    }
+
+    HashTableStats getStats() const {
+        return {resizeMode, size, capacity, oldCtrl != nullptr, oldCapacity - migrateCursor, resizeCount, tombstones};
+    }
+
+    void clear() {
+        releaseOld();
+        destroyAll();
+        memset(ctrl, CTRL_EMPTY, capacity);
+        size = 0;
+        tombstones = 0;
+    }
+
+    bool isEmpty() const {
+        return size == 0;
+    }
+
+    string asString() const {
+        ostringstream oss;
+        forEachEntry([&oss](const Entry& entry) { oss << entry.key << ":" << entry.value << ","; });
+        string result = oss.str();
+        if (!result.empty()) {
+            result.pop_back(); // Remove the trailing comma
+        }
+        return result;
+    }
+
+    Entry* find(const K& key) {
+        return locate(key, mixedHash(key));
+    }
+
+    const Entry* find(const K& key) const {
+        return locate(key, mixedHash(key));
+    }
+
+    V& operator[](const K& key) {
+        size_t hash = mixedHash(key);
+        Entry* entry = locate(key, hash);
+        if (entry) return entry->value;
+        return insertNew(key, V(), hash)->value;
+    }
+
+    vector<K> getKeys() const {
+        vector<K> keys;
+        keys.reserve(size);
+        forEachEntry([&keys](const Entry& entry) { keys.push_back(entry.key); });
+        return keys;
+    }
+
+    vector<V> getValues() const {
+        vector<V> values;
+        values.reserve(size);
+        forEachEntry([&values](const Entry& entry) { values.push_back(entry.value); });
+        return values;
+    }
+
+    // Visit every key-value pair without copying them out
+    template <typename Visitor>
+    void forEach(Visitor visit) const {
+        forEachEntry([&visit](const Entry& entry) { visit(entry.key, entry.value); });
+    }
+};
+
+#endif // FLATHASHTABLE_H
@@ -22,6 +22,16 @@ public:
         adjList[v].push_back(u); // Undirected graph
     }
 
+    // Replace a node's adjacency list as-is; the caller keeps the lists symmetric (bulk loading)
+    void setNeighbors(const T& node, vector<T> neighbors) {
+        adjList[node] = std::move(neighbors);
+    }
+
+    // Pre-size the node table before a bulk load
+    void reserve(size_t nodeCount) {
+        adjList.reserve(nodeCount);
+    }
+
     // Add a node to the graph
     void addNode(const T& node) {
         if (adjList.find(node) == adjList.end()) {
@@ -123,6 +133,25 @@ public:
         return result.str();
     }
 
+    // Rename a node, keeping all of its edges
+    bool renameNode(const T& oldName, const T& newName) {
+        if (adjList.find(oldName) == adjList.end()) return false;
+        if (oldName == newName) return true;
+
+        vector<T> neighbors = adjList[oldName];
+        removeNode(oldName);
+        addNode(newName);
+        bool pendingSelfLoop = false;
+        for (const auto& neighbor : neighbors) {
+            if (neighbor != oldName) {
+                addEdge(newName, neighbor);
+            } else if ((pendingSelfLoop = !pendingSelfLoop)) {
+                addEdge(newName, newName); // Self-loops are listed twice; re-add once
+            }
+        }
+        return true;
+    }
+
     // Check if a node exists in the graph
     bool containsNode(const T& node) const {
         return adjList.find(node) != adjList.end();
@@ -173,6 +202,34 @@ public:
         return true;
     }
 
+    // Get all nodes in the graph
+    vector<T> getNodes() const {
+        vector<T> nodes;
+        nodes.reserve(adjList.size());
+        for (const auto& pair : adjList) {
+            nodes.push_back(pair.first);
+        }
+        return nodes;
+    }
+
+    // Return the edges in the node1-node2,node3-node4 format accepted by ADD_DATA
+    string edgesAsString() const {
+        ostringstream oss;
+        bool first = true;
+        for (const auto& pair : adjList) {
+            size_t selfLoops = 0;
+            for (const auto& neighbor : pair.second) {
+                // Each undirected edge is stored twice; emit it from its smaller endpoint only
+                if (neighbor < pair.first) continue;
+                if (neighbor == pair.first && selfLoops++ % 2 == 1) continue;
+                if (!first) oss << ",";
+                oss << pair.first << "-" << neighbor;
+                first = false;
+            }
+        }
+        return oss.str();
+    }
+
     // Return the graph as a string
     string asString() const {
         ostringstream oss;
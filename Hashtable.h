@@ -31,9 +31,10 @@ private:
         size_t newCapacity = capacity * 2;
         vector<list<Entry>> newTable(newCapacity);
         for (size_t i = 0; i < capacity; ++i) {
-            for (const auto& entry : table[i]) {
-                size_t newIndex = hash(entry.key) % newCapacity;
-                newTable[newIndex].emplace_back(entry.key, entry.value);
+            for (auto& entry : table[i]) {
+                // Reduce the full hash, not an index already taken modulo the old capacity
+                size_t newIndex = hashFunc(entry.key) % newCapacity;
+                newTable[newIndex].push_back(std::move(entry));
             }
         }
         table = std::move(newTable);
@@ -161,6 +162,16 @@ public:
         return keys;
     }
 
+    // Visit every key-value pair without copying them out
+    template <typename Visitor>
+    void forEach(Visitor visit) const {
+        for (size_t i = 0; i < capacity; ++i) {
+            for (const auto& entry : table[i]) {
+                visit(entry.key, entry.value);
+            }
+        }
+    }
+
     vector<V> getValues() const {
         vector<V> values;
         for (size_t i = 0; i < capacity; ++i) {
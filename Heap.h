@@ -1,108 +1,191 @@
 #ifndef HEAP_H
 #define HEAP_H
 
+#include <algorithm>
 #include <iostream>
 #include <vector>
 #include <stdexcept> // for underflow_error
+#include "Data Structures/FlatHashTable.h"
+#include "Data Structures/IndexedHeap.h"
 using namespace std;
 
+// Max-heap of values that may repeat, in two tiers. New values go into a plain binary heap
+// array, so insert and extractMax cost what an unindexed heap does. The first remove of a
+// given value (an EDIT_DATA) moves them into the indexed tier, where each distinct value sits
+// in an indexed heap once, with its number of copies kept alongside, so removing or replacing
+// any value is O(log n). Every value is indexed at most once, so an edit's share stays O(log n)
+// amortised, and a heap that is only filled and drained never pays for the index.
 template <typename T>
 class Heap {
 private:
-    vector<T> heap;
-
-    void heapifyUp(size_t index) {
-        while (index > 0) {
-            size_t parent = (index - 1) / 2;
-            if (heap[index] > heap[parent]) {
-                swap(heap[index], heap[parent]);
-                index = parent;
-            } else {
-                break;
+    IndexedHeap<T, T> heap; // Key and priority are both the value
+    FlatHashTable<T, size_t> copies;
+    vector<T> recent; // Binary max-heap array of values not yet indexed, with repeats
+    size_t total = 0;
+
+    // Expand (value, copies) entries into a flat list, in the order given
+    template <typename Entries>
+    vector<T> expand(const Entries& entries, size_t limit) const {
+        vector<T> values;
+        for (const auto& entry : entries) {
+            for (size_t n = copies.get(entry.key); n > 0 && values.size() < limit; --n) {
+                values.push_back(entry.key);
             }
+            if (values.size() == limit) break;
         }
+        return values;
     }
 
-    void heapifyDown(size_t index) {
-        size_t left = 2 * index + 1;
-        size_t right = 2 * index + 2;
-        size_t largest = index;
+    // Count one more copy of value in the indexed tier
+    void addIndexed(const T& value) {
+        auto* counted = copies.find(value);
+        if (counted) {
+            ++counted->value;
+        } else {
+            copies.insert(value, 1);
+            heap.push(value, value);
+        }
+    }
+
+    void removeIndexed(const T& value) {
+        auto* counted = copies.find(value);
+        if (!counted) throw invalid_argument("Value not found in heap.");
 
-        if (left < heap.size() && heap[left] > heap[largest]) largest = left;
-        if (right < heap.size() && heap[right] > heap[largest]) largest = right;
+        if (--counted->value == 0) {
+            copies.remove(value);
+            heap.remove(value);
+        }
+    }
+
+    // Move the unindexed values into the indexed tier. A batch at least as large as the index
+    // is folded in with one O(n) rebuild rather than a push per value.
+    void indexRecent() {
+        if (recent.empty()) return;
+        if (recent.size() < heap.getSize()) {
+            for (const T& value : recent) addIndexed(value);
+        } else {
+            vector<typename IndexedHeap<T, T>::Entry> distinct(heap.entries().begin(), heap.entries().end());
+            for (const T& value : recent) {
+                auto* counted = copies.find(value);
+                if (counted) {
+                    ++counted->value;
+                } else {
+                    copies.insert(value, 1);
+                    distinct.push_back({value, value});
+                }
+            }
+            heap.build(std::move(distinct));
+        }
+        recent.clear();
+    }
 
-        if (largest != index) {
-            swap(heap[index], heap[largest]);
-            heapifyDown(largest);
+    // The k largest unindexed values, largest first, by walking a frontier down the array
+    vector<T> recentTopK(size_t k) const {
+        vector<T> best;
+        auto below = [this](size_t a, size_t b) { return recent[a] < recent[b]; };
+        vector<size_t> frontier;
+        if (!recent.empty()) frontier.push_back(0);
+        while (!frontier.empty() && best.size() < k) {
+            pop_heap(frontier.begin(), frontier.end(), below);
+            size_t index = frontier.back();
+            frontier.pop_back();
+            best.push_back(recent[index]);
+            for (size_t child = 2 * index + 1; child <= 2 * index + 2 && child < recent.size(); ++child) {
+                frontier.push_back(child);
+                push_heap(frontier.begin(), frontier.end(), below);
+            }
         }
+        return best;
     }
 
 public:
     void insert(const T& value) {
-        heap.push_back(value);
-        heapifyUp(heap.size() - 1);
+        recent.push_back(value);
+        push_heap(recent.begin(), recent.end());
+        ++total;
     }
 
     T extractMax() {
-        if (heap.empty()) throw underflow_error("Heap is empty.");
-        T maxVal = heap[0];
-        heap[0] = heap.back();
-        heap.pop_back();
-        heapifyDown(0);
+        T maxVal = findMax();
+        if (!recent.empty() && recent.front() == maxVal) {
+            pop_heap(recent.begin(), recent.end());
+            recent.pop_back();
+        } else {
+            removeIndexed(maxVal);
+        }
+        --total;
         return maxVal;
     }
 
     T findMax() const {
-        if (heap.empty()) throw underflow_error("Heap is empty.");
-        return heap[0];
+        if (total == 0) throw underflow_error("Heap is empty.");
+        if (heap.isEmpty()) return recent.front();
+        if (recent.empty()) return heap.top().key;
+        return max(heap.top().key, recent.front());
     }
 
     size_t getSize() const {
-        return heap.size();
+        return total;
     }
 
     bool isEmpty() const {
-        return heap.empty();
+        return total == 0;
     }
 
     void clear() {
         heap.clear();
+        copies.clear();
+        vector<T>().swap(recent);
+        total = 0;
     }
 
+    // Replace the contents with elements (any order) in O(n); they are indexed on first remove
     void buildHeap(const vector<T>& elements) {
-        heap = elements;
-        for (int i = (heap.size() / 2) - 1; i >= 0; --i) {
-            heapifyDown(i);
-        }
+        clear();
+        recent = elements;
+        make_heap(recent.begin(), recent.end());
+        total = elements.size();
     }
 
-    vector<T> heapSort() {
-        vector<T> sorted;
-        while (!heap.empty()) {
-            sorted.push_back(extractMax());
-        }
-        return sorted;
+    // The k largest values, largest first, with repeats; the heap is left as it is
+    vector<T> topK(size_t k) const {
+        vector<T> indexed = expand(heap.topK(k), k);
+        vector<T> unindexed = recentTopK(k);
+        vector<T> values(indexed.size() + unindexed.size());
+        merge(indexed.begin(), indexed.end(), unindexed.begin(), unindexed.end(), values.begin(), greater<T>());
+        if (values.size() > k) values.resize(k);
+        return values;
+    }
+
+    // All values, largest first; the heap is left as it is
+    vector<T> heapSort() const {
+        return topK(total);
+    }
+
+    // All values, each repeated once per copy, in no particular order
+    vector<T> toVector() const {
+        vector<T> values = expand(heap.entries(), total);
+        values.insert(values.end(), recent.begin(), recent.end());
+        return values;
     }
 
     void display() const {
-        for (const auto& val : heap) {
+        for (const auto& val : toVector()) {
             cout << val << " ";
         }
         cout << endl;
     }
-void remove(const T& value) {
-    auto it = find(heap.begin(), heap.end(), value);
-    if (it == heap.end()) throw invalid_argument("Value not found in heap.");
 
-    size_t index = it - heap.begin();
-    heap[index] = heap.back();
-    heap.pop_back();
+    // Remove one copy of value
+    void remove(const T& value) {
+        indexRecent();
+        removeIndexed(value);
+        --total;
+    }
 
-    heapifyDown(index);
-}
     string asString() const {
         string result = "[ ";
-        for (const auto& val : heap) {
+        for (const auto& val : toVector()) {
             result += to_string(val) + " ";
         }
         result += "]";
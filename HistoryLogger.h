@@ -0,0 +1,137 @@
+#ifndef HISTORYLOGGER_H
+#define HISTORYLOGGER_H
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdio>
+#include <fstream>
+#include <mutex>
+#include <string>
+#include <thread>
+using namespace std;
+
+// Asynchronous append-only history file. Request threads push lines onto a lock-free stack;
+// one background writer drains it in batches, flushing whenever flushBytes are pending or
+// flushInterval has passed, and rotates the file (path.1, path.2, ...) once it reaches rotateBytes.
+class HistoryLogger {
+private:
+    struct Line {
+        string text;
+        Line* next;
+    };
+
+    atomic<Line*> head;
+    atomic<size_t> pendingBytes;
+
+    string path;
+    size_t flushBytes;
+    chrono::milliseconds flushInterval;
+    size_t rotateBytes;
+    int keepFiles;
+
+    mutex wakeLock;
+    condition_variable wake;
+    bool stopping;
+    ofstream out;
+    size_t fileBytes;
+    thread writer;
+
+    void openFile() {
+        out.open(path, ios::app | ios::binary);
+        out.seekp(0, ios::end);
+        fileBytes = out.is_open() ? static_cast<size_t>(out.tellp()) : 0;
+    }
+
+    // history.txt -> history.txt.1 -> ... -> history.txt.<keepFiles>, dropping the oldest
+    void rotate() {
+        out.close();
+        remove((path + "." + to_string(keepFiles)).c_str());
+        for (int i = keepFiles - 1; i >= 1; --i) {
+            rename((path + "." + to_string(i)).c_str(), (path + "." + to_string(i + 1)).c_str());
+        }
+        rename(path.c_str(), (path + ".1").c_str());
+        openFile();
+    }
+
+    // Take everything queued so far and write it as one batch, oldest line first
+    void drain() {
+        Line* list = head.exchange(nullptr, memory_order_acquire);
+        if (!list) return;
+
+        Line* ordered = nullptr;
+        while (list) {
+            Line* next = list->next;
+            list->next = ordered;
+            ordered = list;
+            list = next;
+        }
+
+        string batch;
+        while (ordered) {
+            batch += ordered->text;
+            Line* done = ordered;
+            ordered = ordered->next;
+            delete done;
+        }
+        pendingBytes.fetch_sub(batch.size(), memory_order_relaxed);
+
+        out.write(batch.data(), batch.size());
+        out.flush();
+        fileBytes += batch.size();
+        if (rotateBytes > 0 && fileBytes >= rotateBytes) rotate();
+    }
+
+    void writerLoop() {
+        while (true) {
+            bool exiting;
+            {
+                unique_lock<mutex> guard(wakeLock);
+                wake.wait_for(guard, flushInterval, [this] {
+                    return stopping || pendingBytes.load(memory_order_relaxed) >= flushBytes;
+                });
+                exiting = stopping;
+            }
+            drain();
+            if (exiting) return;
+        }
+    }
+
+public:
+    HistoryLogger(const string& filePath, size_t flushThresholdBytes = 64 * 1024,
+                  chrono::milliseconds flushPeriod = chrono::milliseconds(200),
+                  size_t rotateThresholdBytes = 64 * 1024 * 1024, int rotatedFilesKept = 5)
+        : head(nullptr), pendingBytes(0), path(filePath), flushBytes(flushThresholdBytes),
+          flushInterval(flushPeriod), rotateBytes(rotateThresholdBytes), keepFiles(rotatedFilesKept),
+          stopping(false), fileBytes(0) {
+        openFile();
+        writer = thread(&HistoryLogger::writerLoop, this);
+    }
+
+    // Flush whatever is still queued before going away
+    ~HistoryLogger() {
+        {
+            lock_guard<mutex> guard(wakeLock);
+            stopping = true;
+        }
+        wake.notify_one();
+        writer.join();
+    }
+
+    HistoryLogger(const HistoryLogger&) = delete;
+    HistoryLogger& operator=(const HistoryLogger&) = delete;
+
+    // Queue one line (a trailing newline is added). Lock-free; never touches the file.
+    void log(const string& line) {
+        Line* node = new Line{line + "\n", head.load(memory_order_relaxed)};
+        size_t bytes = node->text.size();
+        // Count before publishing so the writer never subtracts bytes that weren't added yet
+        size_t before = pendingBytes.fetch_add(bytes, memory_order_relaxed);
+        while (!head.compare_exchange_weak(node->next, node, memory_order_release, memory_order_relaxed)) {
+        }
+
+        if (before < flushBytes && before + bytes >= flushBytes) wake.notify_one();
+    }
+};
+
+#endif // HISTORYLOGGER_H
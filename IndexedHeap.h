@@ -0,0 +1,174 @@
+#ifndef INDEXEDHEAP_H
+#define INDEXEDHEAP_H
+
+#include <algorithm>
+#include <functional>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+#include "Data Structures/FlatHashTable.h"
+using namespace std;
+
+// Binary heap of unique keys ordered by a priority, with a key -> array index map so any key
+// can be re-prioritised or removed in O(log n) instead of being searched for. The key with the
+// highest priority under Compare is on top (less gives a max-heap, greater a min-heap).
+template <typename K, typename P, typename Compare = less<P>, typename Hash = std::hash<K>>
+class IndexedHeap {
+public:
+    struct Entry {
+        K key;
+        P priority;
+    };
+
+private:
+    vector<Entry> heap;
+    FlatHashTable<K, size_t, Hash> positions;
+    Compare compare;
+
+    // True when a belongs below b
+    bool lower(const Entry& a, const Entry& b) const { return compare(a.priority, b.priority); }
+
+    // Put entry at index and record where it went
+    void place(size_t index, Entry&& entry) {
+        positions.find(entry.key)->value = index;
+        heap[index] = std::move(entry);
+    }
+
+    // Both sifts carry the moving entry in hand and shift the others over the hole,
+    // so each level costs one move and one position update instead of a swap
+    void siftUp(size_t index) {
+        Entry moving = std::move(heap[index]);
+        while (index > 0) {
+            size_t parent = (index - 1) / 2;
+            if (!lower(heap[parent], moving)) break;
+            place(index, std::move(heap[parent]));
+            index = parent;
+        }
+        place(index, std::move(moving));
+    }
+
+    void siftDown(size_t index) {
+        Entry moving = std::move(heap[index]);
+        size_t size = heap.size();
+        while (true) {
+            size_t child = 2 * index + 1;
+            if (child >= size) break;
+            if (child + 1 < size && lower(heap[child], heap[child + 1])) ++child;
+            if (!lower(moving, heap[child])) break;
+            place(index, std::move(heap[child]));
+            index = child;
+        }
+        place(index, std::move(moving));
+    }
+
+    // After heap[index] changed, move it whichever way restores the heap order
+    void restore(size_t index) {
+        if (index > 0 && lower(heap[(index - 1) / 2], heap[index])) siftUp(index);
+        else siftDown(index);
+    }
+
+    size_t indexOf(const K& key) const {
+        return positions.get(key); // Throws invalid_argument for unknown keys
+    }
+
+public:
+    IndexedHeap(Compare compare = Compare(), Hash hash = Hash()) : positions(16, hash), compare(compare) {}
+
+    IndexedHeap(const IndexedHeap&) = delete;
+    IndexedHeap& operator=(const IndexedHeap&) = delete;
+
+    void push(const K& key, const P& priority) {
+        if (positions.contains(key)) throw invalid_argument("Key already in heap.");
+        positions.insert(key, heap.size());
+        heap.push_back({key, priority});
+        siftUp(heap.size() - 1);
+    }
+
+    // Change a key's priority, moving it up or down as needed
+    void update(const K& key, const P& priority) {
+        size_t index = indexOf(key);
+        heap[index].priority = priority;
+        restore(index);
+    }
+
+    // Insert the key, or change its priority if it is already queued
+    void pushOrUpdate(const K& key, const P& priority) {
+        if (positions.contains(key)) update(key, priority);
+        else push(key, priority);
+    }
+
+    // The last entry fills the hole; it may belong above or below it
+    void remove(const K& key) {
+        size_t index = indexOf(key);
+        positions.remove(key);
+        Entry last = std::move(heap.back());
+        heap.pop_back();
+        if (index == heap.size()) return;
+        positions.find(last.key)->value = index;
+        heap[index] = std::move(last);
+        restore(index);
+    }
+
+    const Entry& top() const {
+        if (heap.empty()) throw underflow_error("Heap is empty.");
+        return heap[0];
+    }
+
+    Entry pop() {
+        Entry first = top();
+        remove(first.key);
+        return first;
+    }
+
+    bool contains(const K& key) const { return positions.contains(key); }
+
+    P priority(const K& key) const { return heap[indexOf(key)].priority; }
+
+    // Replace the contents with entries (unique keys, any order) in O(n)
+    void build(vector<Entry> entries) {
+        clear();
+        heap = std::move(entries);
+        for (size_t i = 0; i < heap.size(); ++i) {
+            if (positions.contains(heap[i].key)) {
+                clear();
+                throw invalid_argument("Key already in heap.");
+            }
+            positions.insert(heap[i].key, i);
+        }
+        for (size_t i = heap.size() / 2; i-- > 0;) siftDown(i);
+    }
+
+    // The k highest entries, best first, without changing the heap. Expands a frontier of
+    // candidate indices from the root, so it costs O(k log k) however large the heap is.
+    vector<Entry> topK(size_t k) const {
+        vector<Entry> best;
+        if (heap.empty() || k == 0) return best;
+        auto below = [this](size_t a, size_t b) { return lower(heap[a], heap[b]); };
+        vector<size_t> frontier{0};
+        while (!frontier.empty() && best.size() < k) {
+            pop_heap(frontier.begin(), frontier.end(), below);
+            size_t index = frontier.back();
+            frontier.pop_back();
+            best.push_back(heap[index]);
+            for (size_t child = 2 * index + 1; child <= 2 * index + 2 && child < heap.size(); ++child) {
+                frontier.push_back(child);
+                push_heap(frontier.begin(), frontier.end(), below);
+            }
+        }
+        return best;
+    }
+
+    size_t getSize() const { return heap.size(); }
+
+    bool isEmpty() const { return heap.empty(); }
+
+    void clear() {
+        heap.clear();
+        positions.clear();
+    }
+
+    // Entries in heap-array order
+    const vector<Entry>& entries() const { return heap; }
+};
+
+#endif // INDEXEDHEAP_H
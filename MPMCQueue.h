@@ -0,0 +1,121 @@
+#ifndef MPMCQUEUE_H
+#define MPMCQUEUE_H
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <new>
+#include <stdexcept>
+#include <utility>
+using namespace std;
+
+// Bounded lock-free multi-producer/multi-consumer queue (Vyukov's design). Every slot carries
+// a sequence number saying whose turn it is: a producer may fill slot i of lap n when the
+// sequence is i + n * capacity, and a consumer may empty it once the producer bumps it by one.
+// Producers only contend on the enqueue position and consumers on the dequeue position, each
+// with a single compare-and-swap, and the two positions sit on separate cache lines.
+template <typename T>
+class MPMCQueue {
+private:
+    struct alignas(64) Cell {
+        atomic<size_t> sequence;
+        T data;
+    };
+
+    unique_ptr<Cell[]> cells;
+    size_t mask;
+    alignas(64) atomic<size_t> enqueuePos;
+    alignas(64) atomic<size_t> dequeuePos;
+
+    // Claim the next slot to write, or nullptr if the queue is full
+    Cell* claimForWrite() {
+        size_t pos = enqueuePos.load(memory_order_relaxed);
+        while (true) {
+            Cell* cell = &cells[pos & mask];
+            size_t sequence = cell->sequence.load(memory_order_acquire);
+            intptr_t lag = static_cast<intptr_t>(sequence) - static_cast<intptr_t>(pos);
+            if (lag == 0) {
+                if (enqueuePos.compare_exchange_weak(pos, pos + 1, memory_order_relaxed)) return cell;
+            } else if (lag < 0) {
+                return nullptr; // The slot still holds last lap's value
+            } else {
+                pos = enqueuePos.load(memory_order_relaxed);
+            }
+        }
+    }
+
+    void publish(Cell* cell) {
+        size_t pos = cell->sequence.load(memory_order_relaxed);
+        cell->sequence.store(pos + 1, memory_order_release);
+    }
+
+public:
+    // capacity is rounded up to a power of two
+    explicit MPMCQueue(size_t capacity = 1024) {
+        if (capacity < 2) capacity = 2;
+        size_t rounded = 2;
+        while (rounded < capacity) rounded *= 2;
+        cells.reset(new Cell[rounded]);
+        mask = rounded - 1;
+        for (size_t i = 0; i < rounded; ++i) cells[i].sequence.store(i, memory_order_relaxed);
+        enqueuePos.store(0, memory_order_relaxed);
+        dequeuePos.store(0, memory_order_relaxed);
+    }
+
+    MPMCQueue(const MPMCQueue&) = delete;
+    MPMCQueue& operator=(const MPMCQueue&) = delete;
+
+    // False if the queue is full
+    bool tryEnqueue(const T& value) {
+        Cell* cell = claimForWrite();
+        if (!cell) return false;
+        cell->data = value;
+        publish(cell);
+        return true;
+    }
+
+    bool tryEnqueue(T&& value) {
+        Cell* cell = claimForWrite();
+        if (!cell) return false;
+        cell->data = std::move(value);
+        publish(cell);
+        return true;
+    }
+
+    // False if the queue is empty
+    bool tryDequeue(T& out) {
+        size_t pos = dequeuePos.load(memory_order_relaxed);
+        Cell* cell;
+        while (true) {
+            cell = &cells[pos & mask];
+            size_t sequence = cell->sequence.load(memory_order_acquire);
+            intptr_t lag = static_cast<intptr_t>(sequence) - static_cast<intptr_t>(pos + 1);
+            if (lag == 0) {
+                if (dequeuePos.compare_exchange_weak(pos, pos + 1, memory_order_relaxed)) break;
+            } else if (lag < 0) {
+                return false; // Nothing published in this slot yet
+            } else {
+                pos = dequeuePos.load(memory_order_relaxed);
+            }
+        }
+        out = std::move(cell->data);
+        cell->data = T(); // Drop what the slot held (captured state of a task) right away
+        // Hand the slot to the producer of the next lap
+        cell->sequence.store(pos + mask + 1, memory_order_release);
+        return true;
+    }
+
+    // A snapshot that may be stale by the time it returns
+    size_t approximateSize() const {
+        size_t enqueued = enqueuePos.load(memory_order_acquire);
+        size_t dequeued = dequeuePos.load(memory_order_acquire);
+        return enqueued > dequeued ? enqueued - dequeued : 0;
+    }
+
+    bool isEmpty() const { return approximateSize() == 0; }
+
+    size_t getCapacity() const { return mask + 1; }
+};
+
+#endif // MPMCQUEUE_H
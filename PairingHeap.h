@@ -0,0 +1,224 @@
+#ifndef PAIRINGHEAP_H
+#define PAIRINGHEAP_H
+
+#include <algorithm>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+using namespace std;
+
+// Max pairing heap: a multiway tree where every node is at least as large as its children.
+// insert and meld just link two roots, O(1); extractMax pairs up the root's children in two
+// passes, O(log n) amortised. meld takes over another heap's nodes wholesale, so merging two
+// priority clusters costs O(1) however large they are.
+template <typename T>
+class PairingHeap {
+private:
+    struct Node {
+        T data;
+        Node* child = nullptr;   // Leftmost child
+        Node* sibling = nullptr; // Next sibling to the right
+        Node* prev = nullptr;    // Left sibling, or the parent for a leftmost child
+        Node(const T& val) : data(val) {}
+    };
+
+    Node* root = nullptr;
+    size_t count = 0;
+    vector<Node*> pairs; // Scratch for combine, kept to avoid an allocation per extractMax
+
+    // Make the smaller of two roots the leftmost child of the larger
+    static Node* link(Node* a, Node* b) {
+        if (!a) return b;
+        if (!b) return a;
+        if (a->data < b->data) swap(a, b);
+        b->prev = a;
+        b->sibling = a->child;
+        if (a->child) a->child->prev = b;
+        a->child = b;
+        a->sibling = nullptr;
+        a->prev = nullptr;
+        return a;
+    }
+
+    // Two-pass pairing of a sibling list: link neighbours left to right, then fold the
+    // pairs into one tree right to left. Iterative, so long child lists cannot overflow the stack.
+    Node* combine(Node* first) {
+        pairs.clear();
+        while (first) {
+            Node* a = first;
+            Node* b = a->sibling;
+            first = b ? b->sibling : nullptr;
+            a->sibling = a->prev = nullptr;
+            if (b) b->sibling = b->prev = nullptr;
+            pairs.push_back(link(a, b));
+        }
+        Node* merged = nullptr;
+        for (size_t i = pairs.size(); i-- > 0;) merged = link(pairs[i], merged);
+        return merged;
+    }
+
+    // Detach node (not the root) from its parent's child list
+    static void cut(Node* node) {
+        if (node->prev->child == node) node->prev->child = node->sibling;
+        else node->prev->sibling = node->sibling;
+        if (node->sibling) node->sibling->prev = node->prev;
+        node->prev = node->sibling = nullptr;
+    }
+
+    Node* find(const T& value) const {
+        vector<Node*> pending;
+        if (root) pending.push_back(root);
+        while (!pending.empty()) {
+            Node* node = pending.back();
+            pending.pop_back();
+            if (node->data == value) return node;
+            // Children are never larger than their parent, so skip subtrees that cannot hold value
+            if (node->data < value) continue;
+            for (Node* child = node->child; child; child = child->sibling) pending.push_back(child);
+        }
+        return nullptr;
+    }
+
+    // Visit every node, parents before children
+    template <typename Visitor>
+    void forEachNode(Visitor visit) const {
+        vector<Node*> pending;
+        if (root) pending.push_back(root);
+        while (!pending.empty()) {
+            Node* node = pending.back();
+            pending.pop_back();
+            for (Node* child = node->child; child; child = child->sibling) pending.push_back(child);
+            visit(node);
+        }
+    }
+
+public:
+    PairingHeap() {}
+
+    ~PairingHeap() { clear(); }
+
+    PairingHeap(const PairingHeap&) = delete;
+    PairingHeap& operator=(const PairingHeap&) = delete;
+
+    void insert(const T& value) {
+        root = link(root, new Node(value));
+        ++count;
+    }
+
+    // Move every value of other into this heap in O(1); other is left empty
+    void meld(PairingHeap& other) {
+        if (&other == this) return;
+        root = link(root, other.root);
+        count += other.count;
+        other.root = nullptr;
+        other.count = 0;
+    }
+
+    T extractMax() {
+        if (!root) throw underflow_error("Heap is empty.");
+        Node* oldRoot = root;
+        T maxVal = oldRoot->data;
+        root = combine(oldRoot->child);
+        delete oldRoot;
+        --count;
+        return maxVal;
+    }
+
+    T findMax() const {
+        if (!root) throw underflow_error("Heap is empty.");
+        return root->data;
+    }
+
+    // Remove one copy of value. The search is linear (pruned below smaller nodes); unlinking
+    // the node and pairing its children back in is O(log n) amortised.
+    void remove(const T& value) {
+        Node* node = find(value);
+        if (!node) throw invalid_argument("Value not found in heap.");
+        if (node == root) {
+            extractMax();
+            return;
+        }
+        cut(node);
+        root = link(root, combine(node->child));
+        delete node;
+        --count;
+    }
+
+    size_t getSize() const { return count; }
+
+    bool isEmpty() const { return root == nullptr; }
+
+    void clear() {
+        forEachNode([](Node* node) { delete node; });
+        root = nullptr;
+        count = 0;
+    }
+
+    // Replace the contents with elements in O(n). The values are paired off in rounds, each
+    // linking neighbours, until one tree is left, so no node (the root included) ends up with
+    // more than O(log n) children.
+    void buildHeap(const vector<T>& elements) {
+        clear();
+        vector<Node*> trees;
+        trees.reserve(elements.size());
+        for (const T& value : elements) trees.push_back(new Node(value));
+        for (size_t width = trees.size(); width > 1; width = (width + 1) / 2) {
+            for (size_t i = 0; i < width / 2; ++i) trees[i] = link(trees[2 * i], trees[2 * i + 1]);
+            if (width % 2) trees[width / 2] = trees[width - 1];
+        }
+        root = trees.empty() ? nullptr : trees[0];
+        count = elements.size();
+    }
+
+    // The k largest values, largest first, without changing the heap. Each value taken puts
+    // all its children on a frontier, so with at most c children per node this is
+    // O(k c log(k c)). c is O(log n) after buildHeap or an extractMax, but every value
+    // inserted one at a time since then is another child of the root.
+    vector<T> topK(size_t k) const {
+        vector<T> best;
+        if (!root || k == 0) return best;
+        auto below = [](const Node* a, const Node* b) { return a->data < b->data; };
+        vector<const Node*> frontier{root};
+        while (!frontier.empty() && best.size() < k) {
+            pop_heap(frontier.begin(), frontier.end(), below);
+            const Node* node = frontier.back();
+            frontier.pop_back();
+            best.push_back(node->data);
+            for (const Node* child = node->child; child; child = child->sibling) {
+                frontier.push_back(child);
+                push_heap(frontier.begin(), frontier.end(), below);
+            }
+        }
+        return best;
+    }
+
+    // All values, largest first; the heap is left as it is
+    vector<T> heapSort() const {
+        vector<T> sorted = toVector();
+        sort(sorted.begin(), sorted.end(), [](const T& a, const T& b) { return b < a; });
+        return sorted;
+    }
+
+    // Values with every parent before its children
+    vector<T> toVector() const {
+        vector<T> values;
+        values.reserve(count);
+        forEachNode([&values](const Node* node) { values.push_back(node->data); });
+        return values;
+    }
+
+    void display() const {
+        for (const auto& val : toVector()) cout << val << " ";
+        cout << endl;
+    }
+
+    string asString() const {
+        string result = "[ ";
+        for (const auto& val : toVector()) result += to_string(val) + " ";
+        result += "]";
+        return result;
+    }
+};
+
+#endif // PAIRINGHEAP_H
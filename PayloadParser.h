@@ -0,0 +1,137 @@
+#ifndef PAYLOADPARSER_H
+#define PAYLOADPARSER_H
+
+#include <charconv>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <system_error>
+#include <vector>
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+using namespace std;
+
+// Parsing for command text and ADD_DATA payloads. Tokens and fields are string_views into the
+// received frame, and numbers are read with from_chars, so a large payload is scanned in place
+// instead of being copied token by token through a stringstream. Whitespace is found 16 bytes at
+// a time with SSE2; single delimiters (',', ':', '-') go through memchr, which libc vectorizes.
+
+// isspace in the C locale: ' ' and '\t' through '\r'
+inline bool isPayloadSpace(char c) {
+    return c == ' ' || static_cast<unsigned char>(c - '\t') <= '\r' - '\t';
+}
+
+// Index of the first whitespace byte at or after pos, or text.size()
+inline size_t findSpace(string_view text, size_t pos) {
+    const char* data = text.data();
+    size_t size = text.size();
+#ifdef __SSE2__
+    const __m128i space = _mm_set1_epi8(' ');
+    const __m128i tab = _mm_set1_epi8('\t');
+    const __m128i span = _mm_set1_epi8('\r' - '\t');
+    for (; pos + 16 <= size; pos += 16) {
+        __m128i bytes = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + pos));
+        // byte - '\t' <= 4 (unsigned) exactly when min(byte - '\t', 4) leaves it unchanged
+        __m128i offset = _mm_sub_epi8(bytes, tab);
+        __m128i control = _mm_cmpeq_epi8(_mm_min_epu8(offset, span), offset);
+        uint32_t mask = static_cast<uint32_t>(_mm_movemask_epi8(_mm_or_si128(control, _mm_cmpeq_epi8(bytes, space))));
+        if (mask) return pos + __builtin_ctz(mask);
+    }
+#endif
+    while (pos < size && !isPayloadSpace(data[pos])) ++pos;
+    return pos;
+}
+
+// Index of the first non-whitespace byte at or after pos, or text.size(). Separators are
+// usually one byte long, so a plain loop is cheaper than a vector compare here.
+inline size_t skipSpace(string_view text, size_t pos) {
+    while (pos < text.size() && isPayloadSpace(text[pos])) ++pos;
+    return pos;
+}
+
+// Walks the whitespace-separated tokens of a command or payload, like repeated `stream >> word`
+class TokenCursor {
+private:
+    string_view text;
+    size_t pos = 0;
+
+public:
+    explicit TokenCursor(string_view text) : text(text) {}
+
+    // The next token, or an empty view once the text is used up
+    string_view next() {
+        size_t start = skipSpace(text, pos);
+        pos = findSpace(text, start);
+        return text.substr(start, pos - start);
+    }
+
+    // Everything after the tokens read so far, without surrounding whitespace
+    string_view rest() const {
+        size_t start = skipSpace(text, pos);
+        size_t end = text.size();
+        while (end > start && isPayloadSpace(text[end - 1])) --end;
+        return text.substr(start, end - start);
+    }
+};
+
+// Walks fields separated by one delimiter byte, like repeated getline: "a,,b" has an empty middle
+// field, and a trailing delimiter adds no empty field at the end
+class FieldCursor {
+private:
+    string_view text;
+    char delimiter;
+    size_t pos = 0;
+
+public:
+    FieldCursor(string_view text, char delimiter) : text(text), delimiter(delimiter) {}
+
+    bool next(string_view& field) {
+        if (pos >= text.size()) return false;
+        size_t end = text.find(delimiter, pos);
+        if (end == string_view::npos) end = text.size();
+        field = text.substr(pos, end - pos);
+        pos = end + 1;
+        return true;
+    }
+};
+
+// Read a decimal int from the start of text the way `stream >> int` does: optional sign, then
+// digits. Returns how many bytes it used, or 0 if there is no number or it is out of range.
+inline size_t parseIntPrefix(string_view text, int& value) {
+    size_t sign = !text.empty() && text[0] == '+';
+    if (sign && (text.size() == 1 || text[1] == '-')) return 0;
+    const char* first = text.data() + sign;
+    from_chars_result result = from_chars(first, text.data() + text.size(), value);
+    if (result.ec != errc()) return 0;
+    return result.ptr - text.data();
+}
+
+// Whole-token variants: false unless all of text is the number
+inline bool parseInt(string_view text, int& value) {
+    return !text.empty() && parseIntPrefix(text, value) == text.size();
+}
+
+inline bool parseDouble(string_view text, double& value) {
+    size_t sign = !text.empty() && text[0] == '+';
+    if (sign && (text.size() == 1 || text[1] == '-')) return false;
+    const char* last = text.data() + text.size();
+    from_chars_result result = from_chars(text.data() + sign, last, value);
+    return result.ec == errc() && result.ptr == last;
+}
+
+// Append the ints of a whitespace-separated list, stopping at the first thing that isn't one,
+// as a `while (stream >> value)` loop does
+inline void parseIntList(string_view text, vector<int>& values) {
+    size_t pos = skipSpace(text, 0);
+    int value;
+    while (pos < text.size()) {
+        size_t used = parseIntPrefix(text.substr(pos), value);
+        if (used == 0) break;
+        values.push_back(value);
+        pos = skipSpace(text, pos + used);
+    }
+}
+
+#endif // PAYLOADPARSER_H
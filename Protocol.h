@@ -0,0 +1,118 @@
+#ifndef PROTOCOL_H
+#define PROTOCOL_H
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <vector>
+using namespace std;
+
+// Wire format: every request and response is a 4-byte big-endian payload length followed by the payload.
+const size_t FRAME_HEADER_SIZE = 4;
+// Largest request accepted: room for a bulk ADD_DATA of tens of MB, small enough that a client
+// can't pin much memory by declaring a huge frame
+const size_t MAX_FRAME_SIZE = 64 * 1024 * 1024;
+
+// Append one framed message to an output buffer
+inline void appendFrame(string& out, const string& payload) {
+    uint32_t length = static_cast<uint32_t>(payload.size());
+    char header[FRAME_HEADER_SIZE] = {
+        static_cast<char>((length >> 24) & 0xFF),
+        static_cast<char>((length >> 16) & 0xFF),
+        static_cast<char>((length >> 8) & 0xFF),
+        static_cast<char>(length & 0xFF),
+    };
+    out.append(header, FRAME_HEADER_SIZE);
+    out.append(payload);
+}
+
+inline string encodeFrame(const string& payload) {
+    string out;
+    out.reserve(FRAME_HEADER_SIZE + payload.size());
+    appendFrame(out, payload);
+    return out;
+}
+
+inline uint32_t decodeFrameLength(const char* header) {
+    const unsigned char* bytes = reinterpret_cast<const unsigned char*>(header);
+    return (uint32_t(bytes[0]) << 24) | (uint32_t(bytes[1]) << 16) | (uint32_t(bytes[2]) << 8) | uint32_t(bytes[3]);
+}
+
+// Incremental parser over a growable per-connection buffer. Bytes are received straight into
+// the buffer tail and complete frames are popped in arrival order, so pipelined requests are
+// split correctly no matter how the stream was segmented. The buffer grows with the bytes that
+// actually arrive, never with the length a header claims, and shrinks back once a large frame
+// has been consumed.
+class FrameParser {
+private:
+    static constexpr size_t MAX_GROWTH_STEP = 4 * 1024 * 1024; // Past this the buffer grows linearly
+    static constexpr size_t SHRINK_ABOVE = 1024 * 1024;        // A buffer this large held an oversized frame
+    static constexpr size_t RETAINED_BYTES = 256 * 1024;       // What it shrinks back to
+
+    vector<char> buffer;
+    size_t readPos;  // Start of the first unparsed byte
+    size_t writePos; // End of the received bytes
+    bool error;
+
+    void compact() {
+        if (readPos == 0) return;
+        memmove(buffer.data(), buffer.data() + readPos, writePos - readPos);
+        writePos -= readPos;
+        readPos = 0;
+    }
+
+public:
+    FrameParser() : readPos(0), writePos(0), error(false) {}
+
+    // Reserve room for at least n more bytes and return where to write them
+    char* prepare(size_t n) {
+        if (buffer.size() - writePos < n) {
+            compact();
+            if (buffer.size() - writePos < n) {
+                size_t step = min(buffer.size(), MAX_GROWTH_STEP);
+                buffer.resize(max(buffer.size() + step, writePos + n));
+            }
+        }
+        return buffer.data() + writePos;
+    }
+
+    // Mark n bytes written through prepare() as received
+    void commit(size_t n) {
+        writePos += n;
+    }
+
+    void feed(const char* data, size_t n) {
+        memcpy(prepare(n), data, n);
+        commit(n);
+    }
+
+    // Pop the next complete frame; false when more bytes are needed or the stream is corrupt
+    bool next(string& frame) {
+        if (error || writePos - readPos < FRAME_HEADER_SIZE) return false;
+        uint32_t length = decodeFrameLength(buffer.data() + readPos);
+        if (length > MAX_FRAME_SIZE) {
+            error = true;
+            return false;
+        }
+        if (writePos - readPos < FRAME_HEADER_SIZE + length) return false;
+        frame.assign(buffer.data() + readPos + FRAME_HEADER_SIZE, length);
+        readPos += FRAME_HEADER_SIZE + length;
+        if (readPos == writePos) readPos = writePos = 0;
+        if (buffer.size() > SHRINK_ABOVE && bufferedBytes() <= RETAINED_BYTES) {
+            compact();
+            vector<char>(buffer.begin(), buffer.begin() + RETAINED_BYTES).swap(buffer);
+        }
+        return true;
+    }
+
+    bool hasError() const {
+        return error;
+    }
+
+    size_t bufferedBytes() const {
+        return writePos - readPos;
+    }
+};
+
+#endif // PROTOCOL_H
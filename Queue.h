@@ -5,59 +5,96 @@
 #include <sstream>
 #include <stdexcept>
 #include <string>
+#include <utility>
 #include <vector>
 using namespace std;
 
+// FIFO queue in a growable ring buffer. Elements live in one contiguous array whose capacity
+// is a power of two, so enqueue and dequeue just move an index (no allocation per element),
+// operator[] is O(1), and scans walk at most two contiguous runs.
 template <typename T>
 class Queue {
 private:
-    struct Node {
-        T data;
-        Node* next;
-        Node(const T& val) : data(val), next(nullptr) {}
-    };
-
-    Node* front;  // Pointer to the front of the queue
-    Node* rear;   // Pointer to the rear of the queue
-    size_t count; // Number of elements in the queue
+    vector<T> buffer; // Slots; capacity is buffer.size(), always 0 or a power of two
+    size_t head;      // Index of the front element
+    size_t count;     // Number of elements in the queue
+
+    size_t slot(size_t index) const { return (head + index) & (buffer.size() - 1); }
+
+    // Make room for extra more elements, re-laying the contents from index 0
+    void reserveFor(size_t extra) {
+        if (count + extra <= buffer.size()) return;
+        size_t capacity = buffer.empty() ? 16 : buffer.size();
+        while (capacity < count + extra) capacity *= 2;
+
+        vector<T> grown(capacity);
+        for (size_t i = 0; i < count; ++i) grown[i] = std::move(buffer[slot(i)]);
+        buffer.swap(grown);
+        head = 0;
+    }
 
 public:
     // Constructor
-    Queue() : front(nullptr), rear(nullptr), count(0) {}
-
-    // Destructor
-    ~Queue() {
-        while (!isEmpty()) dequeue();
-    }
+    Queue() : head(0), count(0) {}
 
     // Add an element to the rear of the queue
     void enqueue(const T& value) {
-        Node* newNode = new Node(value);
-        if (!rear) {
-            front = rear = newNode;
-        } else {
-            rear->next = newNode;
-            rear = newNode;
-        }
+        reserveFor(1);
+        buffer[slot(count)] = value;
         ++count;
     }
 
+    // Add n elements to the rear in order, growing the buffer at most once
+    void enqueueRange(const T* values, size_t n) {
+        reserveFor(n);
+        for (size_t i = 0; i < n; ++i) buffer[slot(count + i)] = values[i];
+        count += n;
+    }
+
+    void enqueueRange(const vector<T>& values) {
+        enqueueRange(values.data(), values.size());
+    }
+
+    // Put values back at the front in order, so values[0] is the next one dequeued
+    void enqueueFront(const vector<T>& values) {
+        reserveFor(values.size());
+        head = (head - values.size()) & (buffer.size() - 1);
+        for (size_t i = 0; i < values.size(); ++i) buffer[slot(i)] = values[i];
+        count += values.size();
+    }
+
     // Remove an element from the front of the queue
     T dequeue() {
         if (isEmpty()) throw underflow_error("Queue is empty.");
-        Node* toDelete = front;
-        T data = front->data;
-        front = front->next;
-        if (!front) rear = nullptr;
-        delete toDelete;
+        T data = std::move(buffer[head]);
+        buffer[head] = T(); // Release what the slot held (string storage) right away
+        head = slot(1);
         --count;
         return data;
     }
 
+    // Move up to max elements from the front into out; returns how many were taken
+    size_t dequeueBatch(T* out, size_t max) {
+        size_t taken = max < count ? max : count;
+        for (size_t i = 0; i < taken; ++i) {
+            out[i] = std::move(buffer[slot(i)]);
+            buffer[slot(i)] = T();
+        }
+        head = taken == count ? 0 : slot(taken);
+        count -= taken;
+        return taken;
+    }
+
+    vector<T> dequeueBatch(size_t max) {
+        vector<T> taken(max < count ? max : count);
+        dequeueBatch(taken.data(), taken.size());
+        return taken;
+    }
+
     // Get the element at the front of the queue
     T peek() const {
         if (isEmpty()) throw underflow_error("Queue is empty.");
-        return front->data;
+        return buffer[head];
     }
 
     // Check if the queue is empty
@@ -70,20 +107,16 @@ public:
         return count;
     }
 
-    // Clear the queue
+    // Clear the queue and give its buffer back
     void clear() {
-        while (!isEmpty()) {
-            dequeue();
-        }
+        vector<T>().swap(buffer);
+        head = 0;
+        count = 0;
     }
 
     // Display the queue elements
     void display() const {
-        Node* current = front;
-        while (current) {
-            cout << current->data << " ";
-            current = current->next;
-        }
+        for (size_t i = 0; i < count; ++i) cout << buffer[slot(i)] << " ";
         cout << endl;
     }
 
@@ -92,11 +125,9 @@ public:
         if (isEmpty()) return "[]";
         ostringstream oss;
         oss << "[";
-        Node* current = front;
-        while (current) {
-            oss << current->data;
-            if (current->next) oss << ", ";
-            current = current->next;
+        for (size_t i = 0; i < count; ++i) {
+            if (i > 0) oss << ", ";
+            oss << buffer[slot(i)];
         }
         oss << "]";
         return oss.str();
@@ -104,44 +135,47 @@ public:
 
     // Find an element in the queue
     bool find(const T& value) const {
-        Node* current = front;
-        while (current) {
-            if (current->data == value) return true;
-            current = current->next;
+        for (size_t i = 0; i < count; ++i) {
+            if (buffer[slot(i)] == value) return true;
         }
         return false;
     }
 
+    // Overwrite every element equal to value where it stands; returns how many changed
+    size_t replace(const T& value, const T& replacement) {
+        size_t replaced = 0;
+        for (size_t i = 0; i < count; ++i) {
+            T& element = buffer[slot(i)];
+            if (element == value) {
+                element = replacement;
+                ++replaced;
+            }
+        }
+        return replaced;
+    }
+
     // Get the front element of the queue
     T getFront() const {
-        if (isEmpty()) throw underflow_error("Queue is empty.");
-        return front->data;
+        return peek();
     }
 
     // Get the rear element of the queue
     T getRear() const {
         if (isEmpty()) throw underflow_error("Queue is empty.");
-        return rear->data;
+        return buffer[slot(count - 1)];
     }
 
     // Access elements using the [] operator
     T operator[](size_t index) const {
         if (index >= count) throw out_of_range("Index out of range.");
-        Node* current = front;
-        for (size_t i = 0; i < index; ++i) {
-            current = current->next;
-        }
-        return current->data;
+        return buffer[slot(index)];
     }
 
     // Convert the queue to a vector
     vector<T> toVector() const {
         vector<T> result;
-        Node* current = front;
-        while (current) {
-            result.push_back(current->data);
-            current = current->next;
-        }
+        result.reserve(count);
+        for (size_t i = 0; i < count; ++i) result.push_back(buffer[slot(i)]);
         return result;
     }
 };
@@ -0,0 +1,385 @@
+#ifndef SNAPSHOT_H
+#define SNAPSHOT_H
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#include <stdexcept>
+#include <string>
+#include <vector>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include "ClusterCache.h"
+#include "SnapshotBuffer.h"
+using namespace std;
+
+// Binary cluster snapshot:
+//   [8-byte magic "NRDBSNAP"][u32 version][u32 type tag][u64 lsn][type payload]
+// Integers are stored in host byte order (little-endian on every supported target) so that
+// arrays can be copied in bulk. Each data type has its own payload layout:
+//   CircularLinkedList, Queue : u64 count, then count x (u32 length, bytes)
+//   Hashtable                 : u64 count, then count x (key string, value string)
+//   BinaryTree, AVLTree       : u64 count, then count x i32 in ascending order
+//   Heap                      : u64 count, then count x i32 in any order
+//   Graph                     : u32 node count, node name strings, u64 offsets[nodes + 1],
+//                               u32 neighbor ids[offsets[nodes]] (compressed sparse rows)
+//   Weighted graph            : the Graph payload, then f64 weights[offsets[nodes]]
+const char SNAPSHOT_MAGIC[8] = {'N', 'R', 'D', 'B', 'S', 'N', 'A', 'P'};
+const uint32_t SNAPSHOT_VERSION = 1;
+
+enum SnapshotType : uint32_t {
+    SNAPSHOT_EMPTY = 0, // Created but no data type chosen yet
+    SNAPSHOT_CIRCULAR_LINKED_LIST = 1,
+    SNAPSHOT_HASHTABLE = 2,
+    SNAPSHOT_QUEUE = 3,
+    SNAPSHOT_BINARY_TREE = 4,
+    SNAPSHOT_AVL_TREE = 5,
+    SNAPSHOT_GRAPH = 6,
+    SNAPSHOT_HEAP = 7,
+    SNAPSHOT_WEIGHTED_GRAPH = 8, // Graphs with every edge weighing 1 keep writing SNAPSHOT_GRAPH
+};
+
+/// **Per-type serializers**
+
+inline void writeSnapshotPayload(SnapshotWriter& out, const vector<string>& values) {
+    out.put<uint64_t>(values.size());
+    for (const auto& value : values) out.putString(value);
+}
+
+inline vector<string> readStringList(SnapshotReader& in) {
+    uint64_t count = in.get<uint64_t>();
+    vector<string> values;
+    values.reserve(min<uint64_t>(count, 1 << 20));
+    for (uint64_t i = 0; i < count; ++i) values.push_back(in.getString());
+    return values;
+}
+
+inline void writeSnapshotPayload(SnapshotWriter& out, const CircularLinkedList<string>& linkedList) {
+    writeSnapshotPayload(out, linkedList.toVector());
+}
+
+inline void readSnapshotPayload(SnapshotReader& in, CircularLinkedList<string>& linkedList) {
+    for (const auto& value : readStringList(in)) linkedList.insert(value);
+}
+
+inline void writeSnapshotPayload(SnapshotWriter& out, const Queue<string>& queue) {
+    writeSnapshotPayload(out, queue.toVector());
+}
+
+inline void readSnapshotPayload(SnapshotReader& in, Queue<string>& queue) {
+    queue.enqueueRange(readStringList(in));
+}
+
+inline void writeSnapshotPayload(SnapshotWriter& out, const ConcurrentHashTable<string, string>& hashtable) {
+    out.put<uint64_t>(hashtable.getSize());
+    hashtable.forEach([&out](const string& key, const string& value) {
+        out.putString(key);
+        out.putString(value);
+    });
+}
+
+inline void readSnapshotPayload(SnapshotReader& in, unique_ptr<ConcurrentHashTable<string, string>>& hashtable) {
+    uint64_t count = in.get<uint64_t>();
+    // Size the table up front so the bulk load never rehashes
+    hashtable.reset(new ConcurrentHashTable<string, string>(HASHTABLE_CLUSTER_SHARDS));
+    hashtable->reserve(count);
+    for (uint64_t i = 0; i < count; ++i) {
+        string key = in.getString();
+        hashtable->insert(key, in.getString());
+    }
+    hashtable->setResizeMode(ResizeMode::Incremental);
+}
+
+inline void writeSnapshotPayload(SnapshotWriter& out, const vector<int32_t>& values) {
+    out.put<uint64_t>(values.size());
+    out.putArray(values);
+}
+
+inline vector<int32_t> readIntArray(SnapshotReader& in) {
+    uint64_t count = in.get<uint64_t>();
+    return in.getArray<int32_t>(count);
+}
+
+// Tree payloads are written in ascending order; anything else means the file is damaged
+inline vector<int32_t> readSortedIntArray(SnapshotReader& in) {
+    vector<int32_t> values = readIntArray(in);
+    if (!is_sorted(values.begin(), values.end())) throw runtime_error("Snapshot tree values are out of order.");
+    return values;
+}
+
+inline void writeSnapshotPayload(SnapshotWriter& out, const BinaryTree<int>& binaryTree) {
+    writeSnapshotPayload(out, binaryTree.toVector());
+}
+
+inline void readSnapshotPayload(SnapshotReader& in, BinaryTree<int>& binaryTree) {
+    binaryTree.buildFromSorted(readSortedIntArray(in));
+}
+
+inline void writeSnapshotPayload(SnapshotWriter& out, const AVLTree<int>& avlTree) {
+    writeSnapshotPayload(out, avlTree.toVector());
+}
+
+inline void readSnapshotPayload(SnapshotReader& in, AVLTree<int>& avlTree) {
+    avlTree.buildFromSorted(readSortedIntArray(in));
+}
+
+// Same payload as the pointer trees, so a snapshot loads under either tree engine
+inline void writeSnapshotPayload(SnapshotWriter& out, const BPlusTree<int>& orderedTree) {
+    writeSnapshotPayload(out, orderedTree.toVector());
+}
+
+inline void readSnapshotPayload(SnapshotReader& in, BPlusTree<int>& orderedTree) {
+    orderedTree.buildFromSorted(readSortedIntArray(in));
+}
+
+// Every heap engine writes the same value array, and buildHeap accepts it in any order in O(n),
+// so a snapshot from one engine loads into another
+inline void writeSnapshotPayload(SnapshotWriter& out, const Heap<int>& heap) {
+    writeSnapshotPayload(out, heap.toVector());
+}
+
+inline void readSnapshotPayload(SnapshotReader& in, Heap<int>& heap) {
+    heap.buildHeap(readIntArray(in));
+}
+
+inline void writeSnapshotPayload(SnapshotWriter& out, const DaryHeap<int>& heap) {
+    writeSnapshotPayload(out, heap.toVector());
+}
+
+inline void readSnapshotPayload(SnapshotReader& in, DaryHeap<int>& heap) {
+    heap.buildHeap(readIntArray(in));
+}
+
+inline void writeSnapshotPayload(SnapshotWriter& out, const PairingHeap<int>& heap) {
+    writeSnapshotPayload(out, heap.toVector());
+}
+
+inline void readSnapshotPayload(SnapshotReader& in, PairingHeap<int>& heap) {
+    heap.buildHeap(readIntArray(in));
+}
+
+// The payload is the engine's own layout, so both directions are straight array copies
+inline void writeSnapshotPayload(SnapshotWriter& out, const CsrGraph<string>& graph) {
+    vector<uint64_t> offsets;
+    vector<uint32_t> targets;
+    vector<double> weights;
+    graph.exportRows(offsets, targets, &weights);
+
+    out.put<uint32_t>(static_cast<uint32_t>(graph.size()));
+    for (uint32_t id = 0; id < graph.size(); ++id) out.putString(graph.nodeName(id));
+    out.putArray(offsets);
+    out.putArray(targets);
+    if (graph.isWeighted()) out.putArray(weights);
+}
+
+inline void readSnapshotPayload(SnapshotReader& in, CsrGraph<string>& graph, bool weighted) {
+    uint32_t nodeCount = in.get<uint32_t>();
+    vector<string> nodes;
+    nodes.reserve(min<uint32_t>(nodeCount, 1 << 20));
+    for (uint32_t i = 0; i < nodeCount; ++i) nodes.push_back(in.getString());
+    vector<uint64_t> offsets = in.getArray<uint64_t>(size_t(nodeCount) + 1);
+    vector<uint32_t> targets = in.getArray<uint32_t>(offsets.back());
+    vector<double> weights;
+    if (weighted) weights = in.getArray<double>(offsets.back());
+
+    if (offsets[0] != 0) throw runtime_error("Snapshot is corrupt.");
+    for (uint32_t i = 0; i < nodeCount; ++i) {
+        if (offsets[i] > offsets[i + 1]) throw runtime_error("Snapshot is corrupt.");
+    }
+    for (uint32_t target : targets) {
+        if (target >= nodeCount) throw runtime_error("Snapshot is corrupt.");
+    }
+    for (double weight : weights) {
+        if (!(weight >= 0 && isfinite(weight))) throw runtime_error("Snapshot is corrupt.");
+    }
+    if (!graph.assign(std::move(nodes), offsets, std::move(targets), std::move(weights))) throw runtime_error("Snapshot is corrupt.");
+}
+
+/// **Cluster snapshots**
+
+inline string encodeSnapshot(const Cluster& cluster) {
+    SnapshotWriter out;
+    out.data().append(SNAPSHOT_MAGIC, sizeof(SNAPSHOT_MAGIC));
+    out.put<uint32_t>(SNAPSHOT_VERSION);
+
+    uint32_t type = SNAPSHOT_EMPTY;
+    if (cluster.linkedList) type = SNAPSHOT_CIRCULAR_LINKED_LIST;
+    else if (cluster.hashtable) type = SNAPSHOT_HASHTABLE;
+    else if (cluster.queue) type = SNAPSHOT_QUEUE;
+    else if (cluster.binaryTree) type = SNAPSHOT_BINARY_TREE;
+    else if (cluster.avlTree) type = SNAPSHOT_AVL_TREE;
+    else if (cluster.orderedTree) type = cluster.dataType == "AVLTree" ? SNAPSHOT_AVL_TREE : SNAPSHOT_BINARY_TREE;
+    else if (cluster.graph) type = cluster.graph->isWeighted() ? SNAPSHOT_WEIGHTED_GRAPH : SNAPSHOT_GRAPH;
+    else if (cluster.heap || cluster.daryHeap || cluster.pairingHeap) type = SNAPSHOT_HEAP;
+    out.put<uint32_t>(type);
+    out.put<uint64_t>(cluster.lsn);
+
+    if (cluster.linkedList) writeSnapshotPayload(out, *cluster.linkedList);
+    else if (cluster.hashtable) writeSnapshotPayload(out, *cluster.hashtable);
+    else if (cluster.queue) writeSnapshotPayload(out, *cluster.queue);
+    else if (cluster.binaryTree) writeSnapshotPayload(out, *cluster.binaryTree);
+    else if (cluster.avlTree) writeSnapshotPayload(out, *cluster.avlTree);
+    else if (cluster.orderedTree) writeSnapshotPayload(out, *cluster.orderedTree);
+    else if (cluster.graph) writeSnapshotPayload(out, *cluster.graph);
+    else if (cluster.heap) writeSnapshotPayload(out, *cluster.heap);
+    else if (cluster.daryHeap) writeSnapshotPayload(out, *cluster.daryHeap);
+    else if (cluster.pairingHeap) writeSnapshotPayload(out, *cluster.pairingHeap);
+    return std::move(out.data());
+}
+
+// Rebuild a cluster from a snapshot image; throws runtime_error if the image is invalid
+inline void decodeSnapshot(const char* data, size_t size, Cluster& cluster) {
+    SnapshotReader in(data, size);
+    if (memcmp(in.bytes(sizeof(SNAPSHOT_MAGIC)), SNAPSHOT_MAGIC, sizeof(SNAPSHOT_MAGIC)) != 0) {
+        throw runtime_error("Not a cluster snapshot.");
+    }
+    if (in.get<uint32_t>() != SNAPSHOT_VERSION) throw runtime_error("Unsupported snapshot version.");
+    uint32_t type = in.get<uint32_t>();
+    cluster.lsn = in.get<uint64_t>();
+
+    switch (type) {
+        case SNAPSHOT_EMPTY:
+            break;
+        case SNAPSHOT_CIRCULAR_LINKED_LIST:
+            setClusterType(cluster, "CircularLinkedList");
+            readSnapshotPayload(in, *cluster.linkedList);
+            break;
+        case SNAPSHOT_HASHTABLE:
+            setClusterType(cluster, "Hashtable");
+            readSnapshotPayload(in, cluster.hashtable);
+            break;
+        case SNAPSHOT_QUEUE:
+            setClusterType(cluster, "Queue");
+            readSnapshotPayload(in, *cluster.queue);
+            break;
+        case SNAPSHOT_BINARY_TREE:
+            setClusterType(cluster, "BinaryTree");
+            if (cluster.orderedTree) readSnapshotPayload(in, *cluster.orderedTree);
+            else readSnapshotPayload(in, *cluster.binaryTree);
+            break;
+        case SNAPSHOT_AVL_TREE:
+            setClusterType(cluster, "AVLTree");
+            if (cluster.orderedTree) readSnapshotPayload(in, *cluster.orderedTree);
+            else readSnapshotPayload(in, *cluster.avlTree);
+            break;
+        case SNAPSHOT_GRAPH:
+        case SNAPSHOT_WEIGHTED_GRAPH:
+            setClusterType(cluster, "Graph");
+            readSnapshotPayload(in, *cluster.graph, type == SNAPSHOT_WEIGHTED_GRAPH);
+            break;
+        case SNAPSHOT_HEAP:
+            setClusterType(cluster, "Heap");
+            if (cluster.daryHeap) readSnapshotPayload(in, *cluster.daryHeap);
+            else if (cluster.pairingHeap) readSnapshotPayload(in, *cluster.pairingHeap);
+            else readSnapshotPayload(in, *cluster.heap);
+            break;
+        default:
+            throw runtime_error("Unknown snapshot data type.");
+    }
+    // Leftover bytes mean a length field was wrong or the file holds something else too
+    if (!in.atEnd()) throw runtime_error("Snapshot is corrupt.");
+}
+
+/// **Graph edge logs**
+
+// A Graph cluster is persisted as a base snapshot plus an append-only edge log beside it, so a
+// checkpoint after ADD_DATA writes only the new edges instead of the whole graph. The log is a
+// run of segments, one per checkpoint:
+//   [8-byte magic "NRDBEDGE"][u64 lsn][u64 payload length][u64 FNV-1a hash of payload][payload]
+// where the payload is edge records (encodeEdgeRecord): the two node names, then an f64 weight.
+// Segments the base snapshot already covers (lsn <= its lsn) are skipped on load, and a torn or
+// corrupt segment ends the log.
+const char EDGE_LOG_MAGIC[8] = {'N', 'R', 'D', 'B', 'E', 'D', 'G', 'E'};
+const size_t EDGE_LOG_HEADER_BYTES = sizeof(EDGE_LOG_MAGIC) + 3 * sizeof(uint64_t);
+
+inline uint64_t edgeLogHash(const char* data, size_t n) {
+    uint64_t hash = 14695981039346656037ull;
+    for (size_t i = 0; i < n; ++i) hash = (hash ^ static_cast<unsigned char>(data[i])) * 1099511628211ull;
+    return hash;
+}
+
+inline string encodeEdgeLogSegment(uint64_t lsn, const string& records) {
+    SnapshotWriter out;
+    out.data().append(EDGE_LOG_MAGIC, sizeof(EDGE_LOG_MAGIC));
+    out.put<uint64_t>(lsn);
+    out.put<uint64_t>(records.size());
+    out.put<uint64_t>(edgeLogHash(records.data(), records.size()));
+    out.data() += records;
+    return std::move(out.data());
+}
+
+// Add the edges of every intact segment to a graph cluster just decoded from its base snapshot.
+// Returns the length of the intact prefix; anything after it is a torn append.
+inline size_t replayEdgeLog(const char* data, size_t size, Cluster& cluster) {
+    size_t pos = 0;
+    while (size - pos >= EDGE_LOG_HEADER_BYTES) {
+        SnapshotReader header(data + pos, EDGE_LOG_HEADER_BYTES);
+        if (memcmp(header.bytes(sizeof(EDGE_LOG_MAGIC)), EDGE_LOG_MAGIC, sizeof(EDGE_LOG_MAGIC)) != 0) break;
+        uint64_t lsn = header.get<uint64_t>();
+        uint64_t length = header.get<uint64_t>();
+        uint64_t hash = header.get<uint64_t>();
+        const char* payload = data + pos + EDGE_LOG_HEADER_BYTES;
+        if (size - pos - EDGE_LOG_HEADER_BYTES < length || edgeLogHash(payload, length) != hash) break;
+
+        if (lsn > cluster.lsn) {
+            SnapshotReader in(payload, length);
+            while (!in.atEnd()) {
+                string from = in.getString();
+                string to = in.getString();
+                double weight = in.get<double>();
+                if (!(weight >= 0 && isfinite(weight))) throw runtime_error("Edge log is corrupt.");
+                cluster.graph->addEdge(from, to, weight);
+            }
+            cluster.lsn = lsn;
+        }
+        pos += EDGE_LOG_HEADER_BYTES + length;
+    }
+    return pos;
+}
+
+// Replay the edge log at path, if there is one. Returns its size on disk; intact is false if it
+// ends in a torn segment, which the caller should drop by rewriting the snapshot.
+inline size_t loadEdgeLogFile(const string& path, Cluster& cluster, bool& intact) {
+    ifstream file(path, ios::binary);
+    string data((istreambuf_iterator<char>(file)), istreambuf_iterator<char>());
+    intact = replayEdgeLog(data.data(), data.size(), cluster) == data.size();
+    return data.size();
+}
+
+// Map a snapshot file and decode it in place; false if the file doesn't exist
+inline bool loadSnapshotFile(const string& path, Cluster& cluster) {
+    int fd = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0) return false;
+
+    struct stat info;
+    if (fstat(fd, &info) != 0) {
+        close(fd);
+        throw runtime_error("Cannot stat snapshot " + path);
+    }
+    size_t size = info.st_size;
+    if (size == 0) {
+        close(fd);
+        throw runtime_error("Snapshot is truncated.");
+    }
+
+    void* mapped = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (mapped == MAP_FAILED) throw runtime_error("Cannot map snapshot " + path);
+    madvise(mapped, size, MADV_SEQUENTIAL);
+
+    try {
+        decodeSnapshot(static_cast<const char*>(mapped), size, cluster);
+    } catch (...) {
+        munmap(mapped, size);
+        throw;
+    }
+    munmap(mapped, size);
+    return true;
+}
+
+#endif // SNAPSHOT_H
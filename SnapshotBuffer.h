@@ -0,0 +1,92 @@
+#ifndef SNAPSHOTBUFFER_H
+#define SNAPSHOTBUFFER_H
+
+#include <cstdint>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+#include <vector>
+using namespace std;
+
+// Byte-level encoding shared by snapshots (Snapshot.h) and the graph edge-log records that
+// clusters buffer between checkpoints (ClusterCache.h), so both are written by SnapshotWriter
+// and read back by SnapshotReader.
+
+class SnapshotWriter {
+private:
+    string buffer;
+
+public:
+    template <typename U>
+    void put(U value) {
+        buffer.append(reinterpret_cast<const char*>(&value), sizeof(U));
+    }
+
+    void putString(const string& value) {
+        put<uint32_t>(static_cast<uint32_t>(value.size()));
+        buffer += value;
+    }
+
+    template <typename U>
+    void putArray(const vector<U>& values) {
+        buffer.append(reinterpret_cast<const char*>(values.data()), values.size() * sizeof(U));
+    }
+
+    string& data() {
+        return buffer;
+    }
+};
+
+// Bounds-checked cursor over a snapshot image; throws runtime_error on truncated input
+class SnapshotReader {
+private:
+    const char* data;
+    size_t size;
+    size_t pos;
+
+    void require(size_t n) const {
+        if (size - pos < n) throw runtime_error("Snapshot is truncated.");
+    }
+
+public:
+    SnapshotReader(const char* bytes, size_t n) : data(bytes), size(n), pos(0) {}
+
+    template <typename U>
+    U get() {
+        require(sizeof(U));
+        U value;
+        memcpy(&value, data + pos, sizeof(U));
+        pos += sizeof(U);
+        return value;
+    }
+
+    string getString() {
+        uint32_t length = get<uint32_t>();
+        require(length);
+        string value(data + pos, length);
+        pos += length;
+        return value;
+    }
+
+    template <typename U>
+    vector<U> getArray(size_t count) {
+        if (count > (size - pos) / sizeof(U)) throw runtime_error("Snapshot is truncated.");
+        vector<U> values(count);
+        memcpy(values.data(), data + pos, count * sizeof(U));
+        pos += count * sizeof(U);
+        return values;
+    }
+
+    const char* bytes(size_t n) {
+        require(n);
+        const char* start = data + pos;
+        pos += n;
+        return start;
+    }
+
+    bool atEnd() const {
+        return pos == size;
+    }
+};
+
+#endif // SNAPSHOTBUFFER_H
@@ -0,0 +1,104 @@
+#ifndef THREADPOOL_H
+#define THREADPOOL_H
+
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include "MPMCQueue.h"
+using namespace std;
+
+// Fixed set of workers fed through a lock-free task queue. Submitting and taking a task never
+// touch a lock; the mutex below is only for parking workers that found nothing to do.
+class ThreadPool {
+private:
+    static const size_t TASK_QUEUE_CAPACITY = 16384;
+    static const int IDLE_SPINS = 64; // Tries (with a yield between) before a worker parks
+
+    vector<thread> workers;
+    MPMCQueue<function<void()>> tasks;
+    mutex parkMutex;
+    condition_variable wakeup;
+    atomic<size_t> parked;
+    atomic<bool> stopping;
+
+    inline static thread_local ThreadPool* workerOf = nullptr; // The pool this thread works for
+
+    bool tryTake(function<void()>& task) {
+        for (int spin = 0; spin < IDLE_SPINS; ++spin) {
+            if (tasks.tryDequeue(task)) return true;
+            this_thread::yield();
+        }
+        return false;
+    }
+
+    void workerLoop() {
+        workerOf = this;
+        function<void()> task;
+        while (true) {
+            if (tryTake(task)) {
+                task();
+                task = nullptr;
+                continue;
+            }
+            unique_lock<mutex> lock(parkMutex);
+            parked.fetch_add(1);
+            // Pairs with the fence in submit: either that submit sees us parked and notifies
+            // under the mutex, or the check below sees its task
+            atomic_thread_fence(memory_order_seq_cst);
+            wakeup.wait(lock, [this] { return stopping.load() || !tasks.isEmpty(); });
+            parked.fetch_sub(1);
+            if (stopping.load() && tasks.isEmpty()) return;
+        }
+    }
+
+public:
+    // Start a fixed number of workers (defaults to one per core)
+    explicit ThreadPool(size_t threadCount = thread::hardware_concurrency())
+        : tasks(TASK_QUEUE_CAPACITY), parked(0), stopping(false) {
+        if (threadCount == 0) threadCount = 1;
+        for (size_t i = 0; i < threadCount; ++i) {
+            workers.emplace_back(&ThreadPool::workerLoop, this);
+        }
+    }
+
+    // Drain the remaining tasks and join every worker
+    ~ThreadPool() {
+        {
+            lock_guard<mutex> lock(parkMutex);
+            stopping = true;
+        }
+        wakeup.notify_all();
+        for (auto& worker : workers) worker.join();
+    }
+
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+
+    // Queue a task for the next idle worker
+    void submit(function<void()> task) {
+        // The queue is bounded; when it is full, wait for workers to make room. A worker runs
+        // the task itself instead: if every worker waited here, nothing would drain the queue.
+        while (!tasks.tryEnqueue(std::move(task))) {
+            if (workerOf == this) {
+                task();
+                return;
+            }
+            this_thread::yield();
+        }
+
+        atomic_thread_fence(memory_order_seq_cst);
+        if (parked.load(memory_order_relaxed) > 0) {
+            lock_guard<mutex> lock(parkMutex);
+            wakeup.notify_one();
+        }
+    }
+
+    size_t getThreadCount() const {
+        return workers.size();
+    }
+};
+
+#endif // THREADPOOL_H
@@ -0,0 +1,41 @@
+#ifndef USERSTORE_H
+#define USERSTORE_H
+
+#include <functional>
+#include <string>
+#include "ConcurrentHashTable.h"
+using namespace std;
+
+// Concurrent in-memory username -> password index. Users are spread over independently
+// locked shards so logins proceed in parallel and only collide with registrations that
+// land on the same shard.
+class UserStore {
+private:
+    ConcurrentHashTable<string, string> passwords;
+
+public:
+    // Register a user; false if the username is taken
+    bool add(const string& username, const string& password) {
+        return passwords.insertIfAbsent(username, password);
+    }
+
+    bool contains(const string& username) const {
+        return passwords.contains(username);
+    }
+
+    bool verify(const string& username, const string& password) const {
+        string stored;
+        return passwords.tryGet(username, stored) && stored == password;
+    }
+
+    size_t size() const {
+        return passwords.getSize();
+    }
+
+    // Visit every user, one shard at a time
+    void forEach(const function<void(const string&, const string&)>& visit) const {
+        passwords.forEach(visit);
+    }
+};
+
+#endif // USERSTORE_H
@@ -0,0 +1,308 @@
+#ifndef WRITEAHEADLOG_H
+#define WRITEAHEADLOG_H
+
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <functional>
+#include <iostream>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include <fcntl.h>
+#include <unistd.h>
+using namespace std;
+
+// Append-only log of cluster mutations. Each record is
+//   [u32 body length][u32 crc32 of body][body]
+// where the body is [u64 lsn][u16 field count] followed by [u32 length][bytes] per field.
+// Writers append under the caller's lock and then wait for a group commit, which writes and
+// fdatasyncs every record buffered since the previous one in a single batch. If a batch can't be
+// written or synced, the log fails: the segment is cut back to its last whole record, waiting
+// writers are told their records aren't durable, and no further records are accepted. A failed
+// log makes the server read-only until restart: writers check healthy() under the lock of the
+// structure they are about to change and refuse the write before touching it.
+class WriteAheadLog {
+private:
+    string directory;
+    chrono::microseconds commitInterval;
+
+    mutex lock;
+    condition_variable pendingReady; // Wakes the committer
+    condition_variable committed;    // Wakes writers waiting for durability
+    string pending;                  // Encoded records not yet written
+    uint64_t nextLsn;
+    uint64_t durableLsn;
+    uint64_t segmentId;
+    int segmentFd;
+    size_t segmentBytes;
+    bool writing;
+    bool stopping;
+    bool failed;
+    thread committer;
+
+    static uint32_t crc32(const char* data, size_t n) {
+        static uint32_t table[256];
+        static once_flag tableInit;
+        call_once(tableInit, [] {
+            for (uint32_t i = 0; i < 256; ++i) {
+                uint32_t c = i;
+                for (int k = 0; k < 8; ++k) c = (c & 1) ? 0xEDB88320u ^ (c >> 1) : c >> 1;
+                table[i] = c;
+            }
+        });
+        uint32_t crc = 0xFFFFFFFFu;
+        for (size_t i = 0; i < n; ++i) crc = table[(crc ^ static_cast<unsigned char>(data[i])) & 0xFF] ^ (crc >> 8);
+        return crc ^ 0xFFFFFFFFu;
+    }
+
+    template <typename U>
+    static void put(string& out, U value) {
+        for (size_t i = 0; i < sizeof(U); ++i) out.push_back(static_cast<char>((value >> (8 * i)) & 0xFF));
+    }
+
+    template <typename U>
+    static U get(const char* data) {
+        U value = 0;
+        for (size_t i = 0; i < sizeof(U); ++i) value |= U(static_cast<unsigned char>(data[i])) << (8 * i);
+        return value;
+    }
+
+    static string encode(uint64_t lsn, const vector<string>& fields) {
+        string body;
+        put<uint64_t>(body, lsn);
+        put<uint16_t>(body, static_cast<uint16_t>(fields.size()));
+        for (const auto& field : fields) {
+            put<uint32_t>(body, static_cast<uint32_t>(field.size()));
+            body += field;
+        }
+        string record;
+        record.reserve(8 + body.size());
+        put<uint32_t>(record, static_cast<uint32_t>(body.size()));
+        put<uint32_t>(record, crc32(body.data(), body.size()));
+        return record + body;
+    }
+
+    string segmentPath(uint64_t id) const {
+        char name[32];
+        snprintf(name, sizeof(name), "%016llu.log", static_cast<unsigned long long>(id));
+        return directory + "/" + name;
+    }
+
+    string checkpointPath() const {
+        return directory + "/checkpoint";
+    }
+
+    vector<uint64_t> listSegments() const {
+        vector<uint64_t> ids;
+        for (const auto& entry : filesystem::directory_iterator(directory)) {
+            if (entry.path().extension() == ".log") ids.push_back(stoull(entry.path().stem().string()));
+        }
+        sort(ids.begin(), ids.end());
+        return ids;
+    }
+
+    // Feed every intact record of one segment to apply; a torn or corrupt tail ends the segment
+    static uint64_t replaySegment(const string& path, const function<void(uint64_t, const vector<string>&)>& apply) {
+        ifstream file(path, ios::binary);
+        string data((istreambuf_iterator<char>(file)), istreambuf_iterator<char>());
+        uint64_t lastLsn = 0;
+        size_t pos = 0;
+        while (data.size() - pos >= 8) {
+            uint32_t length = get<uint32_t>(data.data() + pos);
+            uint32_t crc = get<uint32_t>(data.data() + pos + 4);
+            if (length < 10 || data.size() - pos - 8 < length) break;
+            const char* body = data.data() + pos + 8;
+            if (crc32(body, length) != crc) break;
+
+            uint64_t lsn = get<uint64_t>(body);
+            uint16_t fieldCount = get<uint16_t>(body + 8);
+            vector<string> fields;
+            size_t offset = 10;
+            bool valid = true;
+            for (uint16_t i = 0; i < fieldCount && valid; ++i) {
+                if (length - offset < 4) { valid = false; break; }
+                uint32_t fieldLength = get<uint32_t>(body + offset);
+                offset += 4;
+                if (length - offset < fieldLength) { valid = false; break; }
+                fields.emplace_back(body + offset, fieldLength);
+                offset += fieldLength;
+            }
+            if (!valid) break;
+
+            apply(lsn, fields);
+            lastLsn = lsn;
+            pos += 8 + length;
+        }
+        return lastLsn;
+    }
+
+    void openSegment(uint64_t id) {
+        segmentId = id;
+        segmentFd = ::open(segmentPath(id).c_str(), O_WRONLY | O_CREAT | O_APPEND | O_CLOEXEC, 0644);
+        segmentBytes = 0;
+        if (segmentFd < 0) cerr << "WAL: failed to open " << segmentPath(id) << "\n";
+    }
+
+    static bool writeAll(int fd, const string& data) {
+        size_t written = 0;
+        while (written < data.size()) {
+            ssize_t n = ::write(fd, data.data() + written, data.size() - written);
+            if (n < 0 && errno == EINTR) continue;
+            if (n <= 0) return false;
+            written += n;
+        }
+        return true;
+    }
+
+    void commitLoop() {
+        unique_lock<mutex> guard(lock);
+        while (true) {
+            pendingReady.wait(guard, [this] { return stopping || !pending.empty(); });
+            if (pending.empty()) return;
+
+            // Give concurrent writers one commit interval to join this batch
+            if (commitInterval.count() > 0 && !stopping) {
+                pendingReady.wait_for(guard, commitInterval, [this] { return stopping; });
+            }
+
+            string batch;
+            batch.swap(pending);
+            uint64_t batchLsn = nextLsn - 1;
+            int fd = segmentFd;
+            writing = true;
+            guard.unlock();
+
+            bool ok = writeAll(fd, batch) && fdatasync(fd) == 0;
+
+            guard.lock();
+            writing = false;
+            if (ok) {
+                segmentBytes += batch.size();
+                durableLsn = batchLsn;
+            } else {
+                // A torn batch mid-segment would hide every record after it from replay
+                cerr << "WAL: write failed, no further records will be accepted\n";
+                if (fd >= 0 && (ftruncate(fd, segmentBytes) != 0 || fdatasync(fd) != 0)) {
+                    cerr << "WAL: failed to truncate " << segmentPath(segmentId) << "\n";
+                }
+                failed = true;
+            }
+            committed.notify_all();
+        }
+    }
+
+public:
+    WriteAheadLog(const string& dir, chrono::microseconds interval)
+        : directory(dir), commitInterval(interval), nextLsn(1), durableLsn(0), segmentId(0),
+          segmentFd(-1), segmentBytes(0), writing(false), stopping(false), failed(false) {}
+
+    ~WriteAheadLog() {
+        {
+            lock_guard<mutex> guard(lock);
+            stopping = true;
+        }
+        pendingReady.notify_all();
+        if (committer.joinable()) committer.join();
+        if (segmentFd >= 0) ::close(segmentFd);
+    }
+
+    WriteAheadLog(const WriteAheadLog&) = delete;
+    WriteAheadLog& operator=(const WriteAheadLog&) = delete;
+
+    // Replay every surviving record in LSN order, then start a fresh segment and the committer
+    void open(const function<void(uint64_t, const vector<string>&)>& apply) {
+        filesystem::create_directories(directory);
+
+        uint64_t lastLsn = 0;
+        ifstream checkpoint(checkpointPath());
+        checkpoint >> lastLsn;
+
+        vector<uint64_t> segments = listSegments();
+        for (uint64_t id : segments) {
+            lastLsn = max(lastLsn, replaySegment(segmentPath(id), apply));
+        }
+
+        nextLsn = lastLsn + 1;
+        durableLsn = lastLsn;
+        openSegment(segments.empty() ? 1 : segments.back() + 1);
+        committer = thread(&WriteAheadLog::commitLoop, this);
+    }
+
+    // Buffer a record for the next group commit and return its LSN. Callers append while holding
+    // the lock of the structure they mutated, so log order matches apply order. A failed log
+    // drops the record, and waitDurable reports it.
+    uint64_t append(const vector<string>& fields) {
+        lock_guard<mutex> guard(lock);
+        uint64_t lsn = nextLsn++;
+        if (failed) return lsn;
+        pending += encode(lsn, fields);
+        pendingReady.notify_one();
+        return lsn;
+    }
+
+    // False once a batch has failed; every later append would be dropped
+    bool healthy() {
+        lock_guard<mutex> guard(lock);
+        return !failed;
+    }
+
+    // Block until the record with this LSN is on disk; false if the log failed first
+    bool waitDurable(uint64_t lsn) {
+        unique_lock<mutex> guard(lock);
+        committed.wait(guard, [&] { return durableLsn >= lsn || failed; });
+        return durableLsn >= lsn;
+    }
+
+    // Seal the current segment and start a new one. Returns the highest LSN in the sealed
+    // segments; once every record up to it is snapshotted, dropSealedSegments() may run.
+    uint64_t rotate() {
+        unique_lock<mutex> guard(lock);
+        uint64_t boundary = nextLsn - 1;
+        committed.wait(guard, [&] { return (durableLsn >= boundary || failed) && !writing; });
+
+        uint64_t sealedLsn = durableLsn;
+        if (segmentFd >= 0) ::close(segmentFd);
+        openSegment(segmentId + 1);
+        return sealedLsn;
+    }
+
+    // Delete segments older than the current one; sealedLsn must come from rotate()
+    void dropSealedSegments(uint64_t sealedLsn) {
+        uint64_t current;
+        {
+            lock_guard<mutex> guard(lock);
+            current = segmentId;
+        }
+
+        // Remember the LSN high-water mark so numbering survives an empty log
+        string tmpPath = checkpointPath() + ".tmp";
+        {
+            ofstream out(tmpPath, ios::trunc);
+            out << sealedLsn << "\n";
+        }
+        int fd = ::open(tmpPath.c_str(), O_RDONLY);
+        if (fd >= 0) {
+            fsync(fd);
+            ::close(fd);
+        }
+        filesystem::rename(tmpPath, checkpointPath());
+
+        for (uint64_t id : listSegments()) {
+            if (id < current) filesystem::remove(segmentPath(id));
+        }
+    }
+
+    size_t currentSegmentBytes() {
+        lock_guard<mutex> guard(lock);
+        return segmentBytes;
+    }
+};
+
+#endif // WRITEAHEADLOG_H
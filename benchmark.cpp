@@ -0,0 +1,527 @@
+// Microbenchmarks for the cluster data structures.
+// Build with optimizations: g++ -O2 -std=c++17 -o benchmark benchmark.cpp -pthread
+// Run "./benchmark" for every suite or "./benchmark <suite>" for one of them.
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <functional>
+#include <iostream>
+#include <mutex>
+#include <random>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+#include "Data Structures/Hashtable.h"
+#include "Data Structures/FlatHashTable.h"
+#include "Data Structures/BinaryTree.h"
+#include "Data Structures/AVLTree.h"
+#include "Data Structures/BPlusTree.h"
+#include "Data Structures/Heap.h"
+#include "Data Structures/DaryHeap.h"
+#include "Data Structures/PairingHeap.h"
+#include "Data Structures/Graph.h"
+#include "Data Structures/CsrGraph.h"
+#include "Data Structures/Queue.h"
+#include "ConcurrentHashTable.h"
+#include "MPMCQueue.h"
+#include "PayloadParser.h"
+using namespace std;
+
+// Keeps results alive so the optimizer cannot drop the work being measured
+static volatile size_t benchmarkSink;
+
+// Runs body once and prints the average nanoseconds per operation
+static void report(const string& name, size_t operations, const function<void()>& body) {
+    auto start = chrono::steady_clock::now();
+    body();
+    double elapsed = chrono::duration<double, nano>(chrono::steady_clock::now() - start).count();
+    printf("  %-36s %10.1f ns/op\n", name.c_str(), elapsed / operations);
+}
+
+// Prints latency percentiles for a list of per-operation timings in nanoseconds
+static void reportLatency(const string& name, vector<double> samples) {
+    sort(samples.begin(), samples.end());
+    auto percentile = [&samples](double p) { return samples[min(samples.size() - 1, size_t(p * samples.size()))]; };
+    printf("  %-36s p50 %8.0f  p99 %8.0f  p99.9 %10.0f  max %12.0f ns\n", name.c_str(),
+           percentile(0.5), percentile(0.99), percentile(0.999), samples.back());
+}
+
+static vector<string> makeKeys(size_t count, const string& prefix, uint32_t seed) {
+    mt19937 random(seed);
+    vector<string> keys;
+    keys.reserve(count);
+    for (size_t i = 0; i < count; ++i) keys.push_back(prefix + to_string(random()) + "-" + to_string(i));
+    return keys;
+}
+
+// Insert, hit, miss and remove costs for one hash table implementation
+template <typename Table>
+static void benchmarkHashTable(const string& name, const vector<string>& keys, const vector<string>& missing) {
+    Table table;
+    size_t n = keys.size();
+    report(name + " insert", n, [&] {
+        for (const auto& key : keys) table.insert(key, key);
+    });
+    report(name + " lookup hit", n, [&] {
+        size_t found = 0;
+        for (const auto& key : keys) found += table.contains(key);
+        benchmarkSink = found;
+    });
+    report(name + " lookup miss", n, [&] {
+        size_t found = 0;
+        for (const auto& key : missing) found += table.contains(key);
+        benchmarkSink = found;
+    });
+    report(name + " get", n, [&] {
+        size_t bytes = 0;
+        for (const auto& key : keys) bytes += table.get(key).size();
+        benchmarkSink = bytes;
+    });
+    report(name + " remove", n, [&] {
+        for (const auto& key : keys) table.remove(key);
+    });
+}
+
+static void hashtableSuite() {
+    for (size_t n : {1000u, 100000u, 1000000u}) {
+        vector<string> keys = makeKeys(n, "key", 1);
+        vector<string> missing = makeKeys(n, "absent", 2);
+        printf("Hashtable, %zu string keys\n", n);
+        benchmarkHashTable<HashTable<string, string>>("chained", keys, missing);
+        benchmarkHashTable<FlatHashTable<string, string>>("flat", keys, missing);
+    }
+}
+
+// Per-insert latency while a flat table grows from empty, in each resize mode
+static void resizeSuite() {
+    size_t n = 2000000;
+    vector<string> keys = makeKeys(n, "key", 3);
+    printf("Hashtable growth, %zu inserts\n", n);
+    for (ResizeMode mode : {ResizeMode::StopTheWorld, ResizeMode::Incremental}) {
+        FlatHashTable<string, string> table;
+        table.setResizeMode(mode);
+        vector<double> samples;
+        samples.reserve(n);
+        for (const auto& key : keys) {
+            auto start = chrono::steady_clock::now();
+            table.insert(key, key);
+            samples.push_back(chrono::duration<double, nano>(chrono::steady_clock::now() - start).count());
+        }
+        HashTableStats stats = table.getStats();
+        reportLatency(mode == ResizeMode::Incremental ? "incremental insert" : "stop-the-world insert", samples);
+        printf("  %-36s %zu resizes, %zu slots, %s\n", "", stats.resizeCount, stats.capacity,
+               stats.resizing ? "still migrating" : "migration done");
+    }
+}
+
+// A FlatHashTable behind one mutex: the baseline the sharded table has to beat
+struct LockedFlatHashTable {
+    mutable mutex lock;
+    FlatHashTable<string, string> table;
+
+    void insert(const string& key, const string& value) {
+        lock_guard<mutex> guard(lock);
+        table.insert(key, value);
+    }
+
+    bool contains(const string& key) const {
+        lock_guard<mutex> guard(lock);
+        return table.contains(key);
+    }
+};
+
+// Runs `threads` workers doing a 95% lookup / 5% insert mix and prints throughput
+template <typename Table>
+static void benchmarkSharedTable(const string& name, Table& table, const vector<string>& keys, unsigned threads) {
+    const size_t operationsPerThread = 1000000;
+    atomic<size_t> found(0);
+    vector<thread> workers;
+    auto start = chrono::steady_clock::now();
+    for (unsigned t = 0; t < threads; ++t) {
+        workers.emplace_back([&, t] {
+            mt19937 random(t + 1);
+            size_t hits = 0;
+            for (size_t i = 0; i < operationsPerThread; ++i) {
+                const string& key = keys[random() % keys.size()];
+                if (i % 20 == 0) {
+                    table.insert(key, key);
+                } else {
+                    hits += table.contains(key);
+                }
+            }
+            found += hits;
+        });
+    }
+    for (auto& worker : workers) worker.join();
+    double seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+    benchmarkSink = found.load();
+    printf("  %-24s %2u threads %10.2f Mops/s\n", name.c_str(), threads, threads * operationsPerThread / seconds / 1e6);
+}
+
+// Throughput of one shared table as client threads are added
+static void concurrentSuite() {
+    vector<string> keys = makeKeys(1000000, "key", 4);
+    unsigned maxThreads = max(1u, thread::hardware_concurrency());
+    printf("Shared hashtable, %zu keys, 95%% lookups\n", keys.size());
+
+    LockedFlatHashTable locked;
+    ConcurrentHashTable<string, string> sharded;
+    for (const auto& key : keys) {
+        locked.insert(key, key);
+        sharded.insert(key, key);
+    }
+    for (unsigned threads = 1; threads <= maxThreads; threads *= 2) {
+        benchmarkSharedTable("single mutex", locked, keys, threads);
+        benchmarkSharedTable("sharded rwlock", sharded, keys, threads);
+    }
+}
+
+// Prints the wall time of one run of body in milliseconds
+static void reportMillis(const string& name, const function<void()>& body) {
+    auto start = chrono::steady_clock::now();
+    body();
+    printf("  %-36s %10.1f ms\n", name.c_str(), chrono::duration<double, milli>(chrono::steady_clock::now() - start).count());
+}
+
+// Rebuilding a tree cluster from its sorted dump: bulk build versus one insert per value
+static void treeSuite() {
+    size_t n = 1000000;
+    vector<int> sorted(n);
+    for (size_t i = 0; i < n; ++i) sorted[i] = static_cast<int>(i * 2);
+    printf("Tree rebuild from %zu sorted values\n", n);
+
+    reportMillis("AVLTree buildFromSorted", [&] {
+        AVLTree<int> tree;
+        tree.buildFromSorted(sorted);
+        benchmarkSink = tree.getHeight();
+    });
+    reportMillis("AVLTree insert one by one", [&] {
+        AVLTree<int> tree;
+        for (int value : sorted) tree.insert(value);
+        benchmarkSink = tree.getHeight();
+    });
+    // A 100-value window of a 1M-value tree: iterator scan versus rendering the whole tree
+    AVLTree<int> window;
+    window.buildFromSorted(sorted);
+    int lo = static_cast<int>(n);
+    report("AVLTree range scan (100 values)", 1000, [&] {
+        size_t total = 0;
+        for (int query = 0; query < 1000; ++query) {
+            size_t taken = 0;
+            for (auto it = window.lowerBound(lo + query); it != window.end() && taken < 100; ++it, ++taken) total += *it;
+        }
+        benchmarkSink = total;
+    });
+    report("AVLTree inorderAsString (full tree)", 1, [&] {
+        benchmarkSink = window.inorderAsString().size();
+    });
+
+    reportMillis("BinaryTree buildFromSorted", [&] {
+        BinaryTree<int> tree;
+        tree.buildFromSorted(sorted);
+        benchmarkSink = tree.getHeight();
+    });
+
+    // Sorted inserts make BinaryTree a chain, so keep this one small enough to finish
+    size_t chain = 20000;
+    vector<int> prefix(sorted.begin(), sorted.begin() + chain);
+    reportMillis("BinaryTree insert one by one (20k)", [&] {
+        BinaryTree<int> tree;
+        for (int value : prefix) tree.insert(value);
+        benchmarkSink = tree.findMax();
+    });
+}
+
+// BinaryTree names its lookup search(); the other trees call it contains()
+template <typename Tree>
+static bool treeContains(const Tree& tree, int value) { return tree.contains(value); }
+
+static bool treeContains(const BinaryTree<int>& tree, int value) { return tree.search(value); }
+
+// Random inserts, point lookups (half of them misses) and a bulk build for one ordered engine
+template <typename Tree>
+static void benchmarkOrderedTree(const string& name, const vector<int>& keys, const vector<int>& sorted, const vector<int>& probes) {
+    {
+        Tree tree;
+        reportMillis(name + " insert (random)", [&] {
+            for (int key : keys) tree.insert(key);
+        });
+        report(name + " lookup", probes.size(), [&] {
+            size_t found = 0;
+            for (int probe : probes) found += treeContains(tree, probe);
+            benchmarkSink = found;
+        });
+    }
+    Tree built;
+    reportMillis(name + " buildFromSorted", [&] { built.buildFromSorted(sorted); });
+}
+
+// 100-value windows through the ordered iterator
+template <typename Tree>
+static void benchmarkRangeScan(const string& name, const vector<int>& sorted, const vector<int>& probes) {
+    Tree tree;
+    tree.buildFromSorted(sorted);
+    size_t queries = min<size_t>(probes.size(), 100000);
+    report(name + " range scan (100 values)", queries, [&] {
+        size_t total = 0;
+        for (size_t query = 0; query < queries; ++query) {
+            size_t taken = 0;
+            for (auto it = tree.lowerBound(probes[query]); it != tree.end() && taken < 100; ++it, ++taken) total += *it;
+        }
+        benchmarkSink = total;
+    });
+}
+
+// The B+tree engine against the pointer trees it can replace, at 10M keys
+static void btreeSuite() {
+    size_t n = 10000000;
+    vector<int> sorted(n);
+    for (size_t i = 0; i < n; ++i) sorted[i] = static_cast<int>(i * 2);
+    vector<int> keys(sorted);
+    shuffle(keys.begin(), keys.end(), mt19937(7));
+    mt19937 random(11);
+    vector<int> probes(1000000);
+    for (int& probe : probes) probe = static_cast<int>(random() % (2 * n));
+    printf("Ordered engines with %zu keys\n", n);
+
+    benchmarkOrderedTree<BPlusTree<int>>("BPlusTree", keys, sorted, probes);
+    benchmarkOrderedTree<AVLTree<int>>("AVLTree", keys, sorted, probes);
+    benchmarkOrderedTree<BinaryTree<int>>("BinaryTree", keys, sorted, probes);
+    benchmarkRangeScan<BPlusTree<int>>("BPlusTree", sorted, probes);
+    benchmarkRangeScan<AVLTree<int>>("AVLTree", sorted, probes);
+}
+
+// Fill a heap with every value, then drain it
+template <typename HeapType>
+static void benchmarkHeap(const string& name, const vector<int>& values) {
+    HeapType heap;
+    report(name + " insert", values.size(), [&] {
+        for (int value : values) heap.insert(value);
+    });
+    report(name + " extractMax", values.size(), [&] {
+        size_t total = 0;
+        while (!heap.isEmpty()) total += heap.extractMax();
+        benchmarkSink = total;
+    });
+}
+
+// Priority-queue throughput of the heap engines at priority-cluster scale
+static void heapSuite() {
+    size_t n = 10000000;
+    mt19937 random(13);
+    vector<int> values(n);
+    for (int& value : values) value = static_cast<int>(random() >> 1);
+    printf("Heap engines with %zu random values\n", n);
+
+    benchmarkHeap<Heap<int>>("Heap (indexed binary)", values);
+    benchmarkHeap<DaryHeap<int, 2>>("DaryHeap<2>", values);
+    benchmarkHeap<DaryHeap<int, 4>>("DaryHeap<4>", values);
+    benchmarkHeap<DaryHeap<int, 8>>("DaryHeap<8>", values);
+    benchmarkHeap<PairingHeap<int>>("PairingHeap", values);
+}
+
+// Load a graph cluster edge by edge, then traverse all of it
+template <typename GraphType>
+static void benchmarkGraph(const string& name, const vector<string>& nodes, const vector<pair<uint32_t, uint32_t>>& edges,
+                           const function<void(const GraphType&)>& more = nullptr) {
+    GraphType graph;
+    report(name + " addEdge", edges.size(), [&] {
+        for (const auto& edge : edges) graph.addEdge(nodes[edge.first], nodes[edge.second]);
+    });
+    reportMillis(name + " isConnected", [&] { benchmarkSink = graph.isConnected(); });
+    reportMillis(name + " bfsAsString", [&] { benchmarkSink = graph.bfsAsString(nodes[0]).size(); });
+    if (more) more(graph);
+}
+
+// The CSR traversals against a plain one-thread queue BFS over the same rows
+static void benchmarkCsrTraversals(const CsrGraph<string>& graph) {
+    reportMillis("CsrGraph queue BFS (baseline)", [&] {
+        vector<bool> visited(graph.size());
+        vector<uint32_t> order{0};
+        visited[0] = true;
+        for (size_t head = 0; head < order.size(); ++head) {
+            graph.forEachNeighbor(order[head], [&](uint32_t neighbor) {
+                if (!visited[neighbor]) {
+                    visited[neighbor] = true;
+                    order.push_back(neighbor);
+                }
+            });
+        }
+        benchmarkSink = order.size();
+    });
+    reportMillis("CsrGraph bfsOrder (direction-opt)", [&] { benchmarkSink = graph.bfsOrder(0).size(); });
+    reportMillis("CsrGraph componentLabels", [&] { benchmarkSink = graph.componentLabels()[0]; });
+    reportMillis("CsrGraph 2-hop neighbourhood", [&] { benchmarkSink = graph.bfsOrder(0, nullptr, 2).size(); });
+    reportMillis("CsrGraph shortestPath (Dijkstra)", [&] {
+        vector<uint32_t> path;
+        benchmarkSink = static_cast<size_t>(graph.shortestPath(0, static_cast<uint32_t>(graph.size() - 1), path));
+    });
+}
+
+// Adjacency lists of names against the CSR engine, at social-graph scale
+static void graphSuite() {
+    size_t nodeCount = 1000000;
+    size_t edgeCount = 10000000;
+    vector<string> nodes = makeKeys(nodeCount, "user", 17);
+    mt19937 random(19);
+    vector<pair<uint32_t, uint32_t>> edges(edgeCount);
+    for (auto& edge : edges) edge = {uint32_t(random() % nodeCount), uint32_t(random() % nodeCount)};
+    printf("Graph engines with %zu nodes and %zu edges\n", nodeCount, edgeCount);
+
+    printf("  (%u hardware threads)\n", thread::hardware_concurrency());
+    benchmarkGraph<CsrGraph<string>>("CsrGraph", nodes, edges, benchmarkCsrTraversals);
+    benchmarkGraph<Graph<string>>("Graph (adjacency lists)", nodes, edges);
+}
+
+// The straightforward way to share a Queue: one mutex around it
+class LockedQueue {
+private:
+    Queue<size_t> queue;
+    mutex lock;
+
+public:
+    bool tryEnqueue(size_t value) {
+        lock_guard<mutex> guard(lock);
+        queue.enqueue(value);
+        return true;
+    }
+
+    bool tryDequeue(size_t& out) {
+        lock_guard<mutex> guard(lock);
+        if (queue.isEmpty()) return false;
+        out = queue.dequeue();
+        return true;
+    }
+};
+
+// Every thread alternates enqueue and dequeue on the shared queue; prints pair throughput
+template <typename SharedQueue>
+static void benchmarkSharedQueue(const string& name, SharedQueue& queue, unsigned threads) {
+    const size_t pairsPerThread = 1000000;
+    atomic<size_t> total(0);
+    vector<thread> workers;
+    auto start = chrono::steady_clock::now();
+    for (unsigned t = 0; t < threads; ++t) {
+        workers.emplace_back([&, t] {
+            size_t sum = 0, value;
+            for (size_t i = 0; i < pairsPerThread; ++i) {
+                while (!queue.tryEnqueue(t + i)) this_thread::yield();
+                while (!queue.tryDequeue(value)) this_thread::yield();
+                sum += value;
+            }
+            total += sum;
+        });
+    }
+    for (auto& worker : workers) worker.join();
+    double seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+    benchmarkSink = total.load();
+    printf("  %-24s %2u threads %10.2f Mpairs/s\n", name.c_str(), threads, threads * pairsPerThread / seconds / 1e6);
+}
+
+// Shared producer/consumer queue as threads are added, past the core count up to 32
+static void mpmcSuite() {
+    printf("Shared queue, enqueue+dequeue pairs\n");
+    for (unsigned threads = 1; threads <= 32; threads *= 2) {
+        LockedQueue locked;
+        MPMCQueue<size_t> lockFree(1024);
+        benchmarkSharedQueue("mutex Queue", locked, threads);
+        benchmarkSharedQueue("MPMCQueue", lockFree, threads);
+    }
+}
+
+// ADD_DATA payload parsing at 50MB: the stringstream loops the cluster code used against PayloadParser
+static void parseSuite() {
+    const size_t payloadBytes = 50 * 1024 * 1024;
+    mt19937 random(23);
+    string ints;
+    size_t intCount = 0;
+    for (; ints.size() < payloadBytes; ++intCount) ints += to_string(int(random())) + " ";
+    string edges;
+    size_t edgeCount = 0;
+    for (; edges.size() < payloadBytes; ++edgeCount) {
+        edges += "user" + to_string(random() % 1000000) + "-user" + to_string(random() % 1000000) + ":" + to_string(random() % 100) + ",";
+    }
+    printf("Payload parsing, %zu MB each\n", payloadBytes >> 20);
+
+    report("stringstream >> int", intCount, [&] {
+        stringstream ss(ints);
+        vector<int> values;
+        int value;
+        while (ss >> value) values.push_back(value);
+        benchmarkSink = values.size();
+    });
+    report("parseIntList", intCount, [&] {
+        vector<int> values;
+        parseIntList(ints, values);
+        benchmarkSink = values.size();
+    });
+    report("stringstream >> word", intCount, [&] {
+        stringstream ss(ints);
+        string word;
+        size_t length = 0;
+        while (ss >> word) length += word.size();
+        benchmarkSink = length;
+    });
+    report("TokenCursor", intCount, [&] {
+        TokenCursor tokens(ints);
+        size_t length = 0;
+        for (string_view token = tokens.next(); !token.empty(); token = tokens.next()) length += token.size();
+        benchmarkSink = length;
+    });
+    report("getline edges + substr + strtod", edgeCount, [&] {
+        stringstream ss(edges);
+        string edge;
+        double total = 0;
+        while (getline(ss, edge, ',')) {
+            size_t dash = edge.find('-');
+            string source = edge.substr(0, dash);
+            string target = edge.substr(dash + 1);
+            size_t colon = target.rfind(':');
+            total += strtod(target.c_str() + colon + 1, nullptr) + source.size();
+            target.resize(colon);
+        }
+        benchmarkSink = size_t(total);
+    });
+    report("FieldCursor edges + parseDouble", edgeCount, [&] {
+        FieldCursor fields(edges, ',');
+        double total = 0;
+        for (string_view edge; fields.next(edge);) {
+            size_t dash = edge.find('-');
+            string_view target = edge.substr(dash + 1);
+            size_t colon = target.rfind(':');
+            double weight;
+            if (parseDouble(target.substr(colon + 1), weight)) total += weight + dash;
+        }
+        benchmarkSink = size_t(total);
+    });
+}
+
+int main(int argc, char* argv[]) {
+    vector<pair<string, function<void()>>> suites = {
+        {"hashtable", hashtableSuite},
+        {"resize", resizeSuite},
+        {"concurrent", concurrentSuite},
+        {"tree", treeSuite},
+        {"btree", btreeSuite},
+        {"heap", heapSuite},
+        {"graph", graphSuite},
+        {"mpmc", mpmcSuite},
+        {"parse", parseSuite},
+    };
+
+    string only = argc > 1 ? argv[1] : "";
+    bool ran = false;
+    for (const auto& suite : suites) {
+        if (!only.empty() && suite.first != only) continue;
+        suite.second();
+        ran = true;
+    }
+    if (!ran) {
+        cerr << "Unknown suite: " << only << endl;
+        return 1;
+    }
+    return 0;
+}
@@ -6,34 +6,15 @@
 #include <sys/socket.h>
 #include <arpa/inet.h>
 #include <unistd.h>
-#include <nlohmann/json.hpp> // Include the nlohmann/json library
-#include <fstream>
+#include "Protocol.h"
 
 using namespace std;
-using json = nlohmann::json; // Define the json alias
 
 // Function declarations
-json loadUserCredentials();
-void saveUserCredentials(const json& userData);
+string sendToServer(int sock, const string& message);
 void registerUser(int sock);
 
 // Function definitions
-json loadUserCredentials() {
-    ifstream file("users.json");
-    json userData;
-    if (file.is_open()) {
-        file >> userData;
-    }
-    return userData;
-}
-
-void saveUserCredentials(const json& userData) {
-    ofstream file("users.json");
-    if (file.is_open()) {
-        file << userData.dump(4); // Pretty-print with 4 spaces
-    }
-}
-
 void registerUser(int sock) {
     string username, password;
     cout << "Enter a new username: ";
@@ -41,14 +22,15 @@ void registerUser(int sock) {
     cout << "Enter a new password: ";
     cin >> password;
 
-    json userData = loadUserCredentials();
-    if (userData.contains(username)) {
+    string response = sendToServer(sock, "REGISTER " + username + " " + password);
+    if (response == "USERNAME_ALREADY_EXISTS") {
         cout << "Username already exists. Please choose a different username.\n";
         return;
     }
-
-    userData[username] = password;
-    saveUserCredentials(userData);
+    if (response != "REGISTRATION_SUCCESS") {
+        cout << "Registration failed: " << response << "\n";
+        return;
+    }
 
     cout << "Registration successful. You can now log in.\n";
 }
@@ -94,13 +76,31 @@ void displayDataEntryInstructions() {
     cout << "Choose your data type and follow the instructions carefully.\n";
 }
 
-string sendToServer(int sock, const string& message) {
-    send(sock, message.c_str(), message.size(), 0);
+// Read exactly n bytes; false if the connection drops first
+bool recvAll(int sock, char* data, size_t n) {
+    size_t received = 0;
+    while (received < n) {
+        ssize_t bytes = recv(sock, data + received, n - received, 0);
+        if (bytes <= 0) return false;
+        received += bytes;
+    }
+    return true;
+}
 
-    char buffer[1024] = {0};
-    recv(sock, buffer, 1024, 0);
+string sendToServer(int sock, const string& message) {
+    string frame = encodeFrame(message);
+    size_t sent = 0;
+    while (sent < frame.size()) {
+        ssize_t bytes = send(sock, frame.data() + sent, frame.size() - sent, 0);
+        if (bytes <= 0) return "";
+        sent += bytes;
+    }
 
-    return string(buffer);
+    char header[FRAME_HEADER_SIZE];
+    if (!recvAll(sock, header, FRAME_HEADER_SIZE)) return "";
+    string response(decodeFrameLength(header), '\0');
+    if (!recvAll(sock, &response[0], response.size())) return "";
+    return response;
 }
 
 int main() {
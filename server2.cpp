@@ -4,26 +4,84 @@
 #include <vector>
 #include <fstream>
 #include <thread>
+#include <chrono>
+#include <mutex>
+#include <shared_mutex>
+#include <memory>
+#include <algorithm>
+#include <numeric>
+#include <cmath>
 #include <filesystem>
+#include <cerrno>
+#include <deque>
+#include <set>
+#include <unordered_map>
 #include <nlohmann/json.hpp>
 #include <sys/socket.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/resource.h>
 #include <arpa/inet.h>
+#include <fcntl.h>
 #include <unistd.h>
 #include "Data Structures/CircularLinkedList.h"
-#include "Data Structures/Hashtable.h"
+#include "Data Structures/FlatHashTable.h"
 #include "Data Structures/Queue.h"
 #include "Data Structures/BinaryTree.h"
 #include "Data Structures/AVLTree.h"
 #include "Data Structures/Graph.h"
 #include "Data Structures/Heap.h"
+#include "ClusterCache.h"
+#include "WriteAheadLog.h"
+#include "Snapshot.h"
+#include "ClusterCatalog.h"
+#include "UserStore.h"
+#include "HistoryLogger.h"
+#include "ThreadPool.h"
+#include "Protocol.h"
+#include "PayloadParser.h"
 
 using namespace std;
 using json = nlohmann::json;
 namespace fs = std::filesystem;
 
+const auto WAL_COMMIT_INTERVAL = chrono::microseconds(500); // How long a group commit waits for more writers
+
 // **Helper Functions**
 
+// Replace a file so that a crash leaves either the old or the new contents, never a truncated mix
+bool writeFileAtomically(const string& path, const string& contents) {
+    string tmpPath = path + ".tmp";
+    int fd = open(tmpPath.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    if (fd < 0) return false;
+
+    size_t written = 0;
+    while (written < contents.size()) {
+        ssize_t n = write(fd, contents.data() + written, contents.size() - written);
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) break;
+        written += n;
+    }
+    bool ok = written == contents.size() && fsync(fd) == 0;
+    close(fd);
+    if (!ok || rename(tmpPath.c_str(), path.c_str()) != 0) {
+        unlink(tmpPath.c_str());
+        return false;
+    }
+
+    // Make the rename itself durable
+    int dirFd = open(fs::path(path).parent_path().c_str(), O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+    if (dirFd >= 0) {
+        fsync(dirFd);
+        close(dirFd);
+    }
+    return true;
+}
+
 /// **Users.json Management**
+UserStore userStore;
+WriteAheadLog userLog("users.wal", WAL_COMMIT_INTERVAL); // Registrations since users.json was last written
+
 json loadUserCredentials() {
     ifstream file("users.json");
     json userData;
@@ -33,33 +91,69 @@ json loadUserCredentials() {
     return userData;
 }
 
-void saveUserCredentials(const json& userData) {
-    ofstream file("users.json");
-    if (file.is_open()) {
-        file << userData.dump(4);
+bool saveUserCredentials(const json& userData) {
+    return writeFileAtomically("users.json", userData.dump(4));
+}
+
+// Load users.json and the registration log once at startup, then fold the log back into users.json
+void loadUsers() {
+    json userData = loadUserCredentials();
+    if (userData.is_object()) {
+        for (const auto& user : userData.items()) {
+            if (user.value().is_string()) userStore.add(user.key(), user.value().get<string>());
+        }
+    }
+
+    size_t replayed = 0;
+    userLog.open([&replayed](uint64_t, const vector<string>& fields) {
+        if (fields.size() == 3 && fields[0] == "REGISTER") {
+            userStore.add(fields[1], fields[2]);
+            ++replayed;
+        }
+    });
+    if (replayed == 0) return;
+
+    uint64_t sealedLsn = userLog.rotate();
+    json compacted = json::object();
+    userStore.forEach([&compacted](const string& username, const string& password) {
+        compacted[username] = password;
+    });
+    if (saveUserCredentials(compacted)) {
+        userLog.dropSealedSegments(sealedLsn);
     }
 }
 
 /// **Cluster Management**
-void ensureClusterDirectoryExists(const string& username) {
-    string userClusterPath = "clusters/" + username;
-    if (!fs::exists(userClusterPath)) {
-        fs::create_directories(userClusterPath);
+const string CLUSTER_ROOT = "clusters";
+
+ClusterCatalog clusterCatalog;
+
+void ensureClusterDirectoryExists(const string& username, const string& clusterName) {
+    string shardPath = CLUSTER_ROOT + "/" + username + "/" + clusterShard(clusterName);
+    if (!fs::exists(shardPath)) {
+        fs::create_directories(shardPath);
     }
 }
+HistoryLogger historyLogger("history.txt");
+
+// Queued for the background history writer; never blocks on the file
 void saveHistory(const string& username, const string& action) {
-    ofstream historyFile("history.txt", ios::app);
-    if (historyFile.is_open()) {
-        historyFile << username << ": " << action << "\n";
-        historyFile.close();
-    }
+    historyLogger.log(username + ": " + action);
 }
+// One snapshot per cluster, spread over hashed subdirectories so users with many clusters
+// don't end up with one huge directory: clusters/<user>/<shard>/<cluster>.snap
 string getClusterFilePath(const string& username, const string& clusterName) {
-    return "clusters/" + username + "/" + username + ".json";
+    return CLUSTER_ROOT + "/" + username + "/" + clusterShard(clusterName) + "/" + clusterName + ".snap";
 }
 
-json loadClusterData(const string& username, const string& clusterName) {
-    string clusterPath = getClusterFilePath(username, clusterName);
+// Unsharded clusters/<user>/<cluster>.<extension> files written by older servers (".json" text or
+// ".snap"); read once and replaced by a sharded snapshot on the next checkpoint
+string getLegacyClusterFilePath(const string& username, const string& clusterName, const string& extension) {
+    return CLUSTER_ROOT + "/" + username + "/" + clusterName + extension;
+}
+
+json loadLegacyClusterData(const string& username, const string& clusterName) {
+    string clusterPath = getLegacyClusterFilePath(username, clusterName, ".json");
     ifstream file(clusterPath);
     json clusterData;
     if (file.is_open()) {
@@ -68,33 +162,222 @@ json loadClusterData(const string& username, const string& clusterName) {
     return clusterData;
 }
 
-void saveClusterData(const string& username, const string& clusterName, const json& data) {
-    ensureClusterDirectoryExists(username);
-    string clusterPath = getClusterFilePath(username, clusterName);
-    ofstream file(clusterPath);
-    if (file.is_open()) {
-        file << data.dump(4);
+// The append-only edge log kept beside a Graph cluster's snapshot
+string getEdgeLogFilePath(const string& username, const string& clusterName) {
+    return CLUSTER_ROOT + "/" + username + "/" + clusterShard(clusterName) + "/" + clusterName + ".edges";
+}
+
+// Append contents and make it durable; on failure the file is cut back to its old length so a
+// torn segment never sits in front of later ones
+bool appendFileDurably(const string& path, const string& contents, size_t oldLength) {
+    int fd = open(path.c_str(), O_WRONLY | O_CREAT | O_APPEND | O_CLOEXEC, 0644);
+    if (fd < 0) return false;
+
+    size_t written = 0;
+    while (written < contents.size()) {
+        ssize_t n = write(fd, contents.data() + written, contents.size() - written);
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) break;
+        written += n;
+    }
+    bool ok = written == contents.size() && fdatasync(fd) == 0;
+    if (!ok && ftruncate(fd, oldLength) == 0) fdatasync(fd);
+    close(fd);
+    if (ok && oldLength == 0) {
+        // A new file: make its directory entry durable too
+        int dirFd = open(fs::path(path).parent_path().c_str(), O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+        if (dirFd >= 0) {
+            fsync(dirFd);
+            close(dirFd);
+        }
     }
+    return ok;
+}
+
+// Persist a cluster. A graph whose only changes are new edges gets them appended to its edge
+// log, O(new edges); anything else rewrites the snapshot and drops the log.
+bool saveClusterData(const string& username, const string& clusterName, Cluster& cluster) {
+    ensureClusterDirectoryExists(username, clusterName);
+    string edgeLogPath = getEdgeLogFilePath(username, clusterName);
+    if (cluster.graph && cluster.edgesOnly) {
+        string segment = encodeEdgeLogSegment(cluster.lsn, cluster.pendingEdges.data());
+        if (appendFileDurably(edgeLogPath, segment, cluster.edgeLogBytes)) {
+            cluster.edgeLogBytes += segment.size();
+            cluster.pendingEdges.data().clear();
+            return true;
+        }
+        requireFullSnapshot(cluster); // The log is suspect now; start over from a snapshot
+        return false;
+    }
+
+    string snapshot = encodeSnapshot(cluster);
+    if (!writeFileAtomically(getClusterFilePath(username, clusterName), snapshot)) return false;
+    // Segments left behind if this unlink is lost are all covered by the snapshot's LSN
+    if (fs::exists(edgeLogPath)) fs::remove(edgeLogPath);
+    cluster.snapshotBytes = snapshot.size();
+    cluster.edgeLogBytes = 0;
+    cluster.edgesOnly = cluster.graph != nullptr;
+
+    for (const char* extension : {".snap", ".json"}) {
+        string legacyPath = getLegacyClusterFilePath(username, clusterName, extension);
+        if (fs::exists(legacyPath)) fs::remove(legacyPath);
+    }
+    return true;
 }
 
 void deleteClusterData(const string& username, const string& clusterName) {
-    string clusterPath = getClusterFilePath(username, clusterName);
-    if (fs::exists(clusterPath)) {
-        fs::remove(clusterPath);
+    for (const string& clusterPath : {getClusterFilePath(username, clusterName), getEdgeLogFilePath(username, clusterName),
+                                      getLegacyClusterFilePath(username, clusterName, ".snap"),
+                                      getLegacyClusterFilePath(username, clusterName, ".json")}) {
+        if (fs::exists(clusterPath)) {
+            fs::remove(clusterPath);
+        }
     }
 }
 
-vector<string> listClusters(const string& username) {
-    ensureClusterDirectoryExists(username);
-    vector<string> clusters;
-    string userClusterPath = "clusters/" + username;
+/// **Resident Cluster Cache**
+const auto CHECKPOINT_INTERVAL = chrono::seconds(60);
+const size_t CHECKPOINT_LOG_BYTES = 64 * 1024 * 1024;      // Checkpoint early once the log grows this large
 
-    for (const auto& entry : fs::directory_iterator(userClusterPath)) {
-        if (entry.is_regular_file() && entry.path().extension() == ".json") {
-            clusters.push_back(entry.path().stem().string());
+ClusterCache clusterCache;
+WriteAheadLog writeAheadLog("wal", WAL_COMMIT_INTERVAL);
+
+// Older servers stored queues as "[a, b, c]"; turn that back into "a b c"
+string stripLegacyQueueFormat(string data) {
+    if (data.size() < 2 || data.front() != '[' || data.back() != ']') return data;
+    data = data.substr(1, data.size() - 2);
+    replace(data.begin(), data.end(), ',', ' ');
+    return data;
+}
+
+// Return the resident cluster, loading its snapshot from disk on first use; nullptr if it doesn't exist
+shared_ptr<Cluster> getCluster(const string& username, const string& clusterName) {
+    shared_ptr<Cluster> cluster = clusterCache.find(username, clusterName);
+    if (cluster) return cluster;
+
+    if (!clusterCatalog.contains(username, clusterName)) return nullptr;
+
+    cluster = make_shared<Cluster>();
+    try {
+        string snapshotPath = getClusterFilePath(username, clusterName);
+        if (loadSnapshotFile(snapshotPath, *cluster)) {
+            if (cluster->graph) {
+                bool intact;
+                cluster->edgeLogBytes = loadEdgeLogFile(getEdgeLogFilePath(username, clusterName), *cluster, intact);
+                cluster->snapshotBytes = fs::file_size(snapshotPath);
+                cluster->edgesOnly = intact;
+                if (!intact) cluster->dirty = true; // Rewrite the snapshot to drop the torn tail
+            }
+            return clusterCache.insert(username, clusterName, cluster);
+        }
+        if (loadSnapshotFile(getLegacyClusterFilePath(username, clusterName, ".snap"), *cluster)) {
+            return clusterCache.insert(username, clusterName, cluster);
+        }
+    } catch (const runtime_error& e) {
+        cerr << "Cannot load cluster " << clusterName << " of " << username << ": " << e.what() << "\n";
+        return nullptr;
+    }
+
+    json clusterData = loadLegacyClusterData(username, clusterName);
+    if (clusterData.is_null()) return nullptr;
+
+    cluster->lsn = clusterData.value("lsn", uint64_t(0));
+    if (clusterData.contains("dataType") && clusterData["dataType"].is_string()) {
+        string dataType = clusterData["dataType"];
+        string data = clusterData.value("data", "");
+        if (dataType == "Queue") data = stripLegacyQueueFormat(data);
+        setClusterType(*cluster, dataType);
+        appendClusterData(*cluster, data);
+    }
+    cluster->dirty = true; // Migrate to a snapshot at the next checkpoint
+    return clusterCache.insert(username, clusterName, cluster);
+}
+
+// Persist every dirty cluster to disk; false if any could not be written
+bool flushClusters() {
+    bool ok = true;
+    clusterCache.forEach([&ok](const string& username, const string& clusterName, const shared_ptr<Cluster>& cluster) {
+        lock_guard<shared_mutex> guard(cluster->lock);
+        if (!cluster->dirty || cluster->deleted) return;
+        // Never let a snapshot get ahead of the log, or a restart could reuse its LSNs
+        if (writeAheadLog.waitDurable(cluster->lsn) && saveClusterData(username, clusterName, *cluster)) {
+            cluster->dirty = false;
+        } else {
+            cerr << "Failed to snapshot cluster " << clusterName << " of " << username << "\n";
+            ok = false;
         }
+    });
+    return ok;
+}
+
+// Snapshot dirty clusters, then drop the log segments those snapshots now cover
+void checkpoint() {
+    uint64_t sealedLsn = writeAheadLog.rotate();
+    if (flushClusters()) {
+        writeAheadLog.dropSealedSegments(sealedLsn);
     }
-    return clusters;
+}
+
+void checkpointLoop() {
+    auto lastCheckpoint = chrono::steady_clock::now();
+    while (true) {
+        this_thread::sleep_for(chrono::seconds(1));
+        if (chrono::steady_clock::now() - lastCheckpoint < CHECKPOINT_INTERVAL &&
+            writeAheadLog.currentSegmentBytes() < CHECKPOINT_LOG_BYTES) {
+            continue;
+        }
+        checkpoint();
+        lastCheckpoint = chrono::steady_clock::now();
+    }
+}
+
+// Re-apply one logged mutation at startup; records already contained in a snapshot are skipped
+void replayLogRecord(uint64_t lsn, const vector<string>& fields) {
+    if (fields.size() < 3) return;
+    const string& operation = fields[0];
+    const string& username = fields[1];
+    const string& clusterName = fields[2];
+
+    shared_ptr<Cluster> cluster = getCluster(username, clusterName);
+    if (operation == "CREATE_CLUSTER") {
+        if (cluster && cluster->lsn >= lsn) return;
+        if (cluster) clusterCache.erase(username, clusterName); // Older incarnation of the name
+        clusterCatalog.add(username, clusterName);
+        cluster = clusterCache.insert(username, clusterName, make_shared<Cluster>());
+        cluster->lsn = lsn;
+        cluster->dirty = true;
+        return;
+    }
+    if (!cluster) return;
+
+    lock_guard<shared_mutex> guard(cluster->lock);
+    if (cluster->lsn >= lsn) return;
+
+    if (operation == "ADD_DATA" && fields.size() == 5) {
+        setClusterType(*cluster, fields[3]);
+        appendClusterData(*cluster, fields[4]);
+    } else if (operation == "EDIT_DATA" && fields.size() == 5) {
+        editClusterData(*cluster, fields[3], fields[4]);
+    } else if (operation == "DEQUEUE" && fields.size() == 4) {
+        if (cluster->queue) cluster->queue->dequeueBatch(stoul(fields[3]));
+    } else if (operation == "DELETE_DATA") {
+        clearClusterData(*cluster);
+    } else if (operation == "DELETE_CLUSTER") {
+        cluster->deleted = true;
+        deleteClusterData(username, clusterName);
+        clusterCatalog.remove(username, clusterName);
+        clusterCache.erase(username, clusterName);
+        return;
+    }
+    cluster->lsn = lsn;
+    cluster->dirty = true;
+}
+
+// Rebuild the state the log describes on top of the last snapshots, then persist it
+void recoverClusters() {
+    clusterCatalog.load(CLUSTER_ROOT);
+    writeAheadLog.open(replayLogRecord);
+    checkpoint();
 }
 
 /// **Command Handlers**
@@ -105,9 +388,7 @@ string handleLogin(const vector<string>& tokens, const string& clientIP) {
     string username = tokens[1];
     string password = tokens[2];
 
-    json userData = loadUserCredentials();
-
-    if (userData.contains(username) && userData[username] == password) {
+    if (userStore.verify(username, password)) {
         return "LOGIN_SUCCESS";
     }
 
@@ -118,23 +399,20 @@ string handleViewClusterData(const vector<string>& tokens, const string& usernam
 
     string clusterName = tokens[1];
 
-    // Load cluster data from persistent storage
-    json clusterData = loadClusterData(username, clusterName);
-    if (clusterData.is_null()) {
+    shared_ptr<Cluster> cluster = getCluster(username, clusterName);
+    if (!cluster) {
         return "CLUSTER_NOT_FOUND";
     }
 
-    // Debug: Print the loaded cluster data
-    cout << "DEBUG: Loaded cluster data: " << clusterData.dump(4) << endl;
-
-    // Extract data type and data
-    string dataType = clusterData["dataType"];
-    string data = clusterData["data"];
+    // Read-only, so concurrent viewers and analyzers of this cluster don't wait on each other
+    shared_lock<shared_mutex> guard(cluster->lock);
+    if (cluster->deleted) return "CLUSTER_NOT_FOUND";
 
     // Format the data based on its type
+    string data = cluster->queue ? cluster->queue->asString() : clusterDataAsString(*cluster);
     stringstream response;
     response << "Cluster: " << clusterName << "\n";
-    response << "Data Type: " << dataType << "\n";
+    response << "Data Type: " << cluster->dataType << "\n";
     response << "Data: " << data << "\n";
 
     return response.str();
@@ -145,13 +423,13 @@ string handleRegister(const vector<string>& tokens) {
     string username = tokens[1];
     string password = tokens[2];
 
-    json userData = loadUserCredentials();
-    if (userData.contains(username)) {
+    if (!userLog.healthy()) return "WRITE_FAILED";
+    if (!userStore.add(username, password)) {
         return "USERNAME_ALREADY_EXISTS";
     }
 
-    userData[username] = password;
-    saveUserCredentials(userData);
+    // Only the new user is appended; users.json is rewritten at the next startup
+    if (!userLog.waitDurable(userLog.append({"REGISTER", username, password}))) return "WRITE_FAILED";
 
     return "REGISTRATION_SUCCESS";
 }
@@ -159,14 +437,30 @@ string handleCreateCluster(const vector<string>& tokens, const string& username)
     if (tokens.size() != 3) return "INVALID_CREATE_FORMAT";
 
     string clusterName = tokens[1];
-    string clusterPath = getClusterFilePath(username, clusterName);
 
-    if (fs::exists(clusterPath)) {
-        return "CLUSTER_ALREADY_EXISTS";
+    shared_ptr<Cluster> existing = getCluster(username, clusterName);
+    if (existing) {
+        // A cluster that is being deleted is gone once its lock is released
+        lock_guard<shared_mutex> guard(existing->lock);
+        if (!existing->deleted) return "CLUSTER_ALREADY_EXISTS";
     }
 
-    json clusterData = json::object();
-    saveClusterData(username, clusterName, clusterData);
+    if (!writeAheadLog.healthy()) return "WRITE_FAILED";
+    shared_ptr<Cluster> cluster = make_shared<Cluster>();
+    lock_guard<shared_mutex> guard(cluster->lock);
+    if (clusterCache.insert(username, clusterName, cluster) != cluster) {
+        return "CLUSTER_ALREADY_EXISTS";
+    }
+    clusterCatalog.add(username, clusterName);
+
+    cluster->lsn = writeAheadLog.append({"CREATE_CLUSTER", username, clusterName});
+    if (!writeAheadLog.waitDurable(cluster->lsn)) {
+        cluster->deleted = true;
+        clusterCatalog.remove(username, clusterName);
+        clusterCache.erase(username, clusterName);
+        return "WRITE_FAILED";
+    }
+    saveClusterData(username, clusterName, *cluster);
     return "CLUSTER_CREATED";
 }
 
@@ -174,18 +468,27 @@ string handleDeleteCluster(const vector<string>& tokens, const string& username)
     if (tokens.size() != 2) return "INVALID_DELETE_FORMAT";
 
     string clusterName = tokens[1];
-    string clusterPath = getClusterFilePath(username, clusterName);
 
-    if (!fs::exists(clusterPath)) {
+    shared_ptr<Cluster> cluster = getCluster(username, clusterName);
+    if (!cluster) {
         return "CLUSTER_NOT_FOUND";
     }
 
+    // Keep the cluster cached (and marked deleted) until its file is gone so nobody reloads it
+    lock_guard<shared_mutex> guard(cluster->lock);
+    if (cluster->deleted) return "CLUSTER_NOT_FOUND";
+    if (!writeAheadLog.waitDurable(writeAheadLog.append({"DELETE_CLUSTER", username, clusterName}))) {
+        return "WRITE_FAILED";
+    }
+    cluster->deleted = true;
     deleteClusterData(username, clusterName);
+    clusterCatalog.remove(username, clusterName);
+    clusterCache.erase(username, clusterName);
     return "CLUSTER_DELETED";
 }
 
 string handleListClusters(const string& username) {
-    vector<string> clusters = listClusters(username);
+    vector<string> clusters = clusterCatalog.list(username);
     if (clusters.empty()) {
         return "NO_CLUSTERS_FOUND";
     }
@@ -197,6 +500,31 @@ string handleListClusters(const string& username) {
     return response.str();
 }
 
+// Hands newly added values to connections parked on DEQUEUE (defined with the client handling)
+void wakeDequeueWaiters(const string& username, const string& clusterName);
+
+// Holds a cluster for a write. Hashtable data guards itself with sharded locks, so a write that
+// keeps a cluster a Hashtable takes the cluster lock only shared and lookups run alongside it;
+// writerLock keeps such writers in log order. Every other write takes the lock exclusively.
+class ClusterWriteGuard {
+private:
+    shared_lock<shared_mutex> shared;
+    unique_lock<shared_mutex> exclusive;
+    unique_lock<mutex> writer;
+
+public:
+    // newType is the type the write sets, or empty if it leaves the type alone
+    ClusterWriteGuard(Cluster& cluster, const string& newType = "") : shared(cluster.lock) {
+        if (cluster.hashtable && (newType.empty() || newType == "Hashtable")) {
+            writer = unique_lock<mutex>(cluster.writerLock);
+            return;
+        }
+        // Anything may change between these two; callers check the cluster after locking
+        shared.unlock();
+        exclusive = unique_lock<shared_mutex>(cluster.lock);
+    }
+};
+
 string handleAddData(const vector<string>& tokens, const string& username) {
     if (tokens.size() < 4) return "INVALID_ADD_FORMAT";
 
@@ -204,137 +532,230 @@ string handleAddData(const vector<string>& tokens, const string& username) {
     string dataType = tokens[2];
     string data = tokens[3];
 
-    // Load cluster data from persistent storage
-    json clusterData = loadClusterData(username, clusterName);
-    if (clusterData.is_null()) return "CLUSTER_NOT_FOUND";
+    shared_ptr<Cluster> cluster = getCluster(username, clusterName);
+    if (!cluster) return "CLUSTER_NOT_FOUND";
+    if (!isSupportedDataType(dataType)) return "DATA_TYPE_NOT_SUPPORTED";
+
+    // Apply to the resident structure and log it under the cluster lock, then wait for the group commit
+    uint64_t lsn;
+    {
+        ClusterWriteGuard guard(*cluster, dataType);
+        if (cluster->deleted) return "CLUSTER_NOT_FOUND";
+        if (!writeAheadLog.healthy()) return "WRITE_FAILED";
+        setClusterType(*cluster, dataType);
+        appendClusterData(*cluster, data);
+        lsn = writeAheadLog.append({"ADD_DATA", username, clusterName, dataType, data});
+        cluster->lsn = lsn;
+        cluster->dirty = true;
+    }
+    if (!writeAheadLog.waitDurable(lsn)) return "WRITE_FAILED";
+    if (dataType == "Queue") wakeDequeueWaiters(username, clusterName);
 
-    // Handle data based on its type and store it in memory
-    if (dataType == "CircularLinkedList") {
-        CircularLinkedList<string> linkedList;
-        if (clusterData.contains("data")) {
-            stringstream ss(clusterData["data"].get<string>());
-            string value;
-            while (ss >> value) linkedList.insert(value);
-        }
-        stringstream ss(data);
-        string value;
-        while (ss >> value) linkedList.insert(value);
-        clusterData["dataType"] = "CircularLinkedList";
-        clusterData["data"] = linkedList.asString();
-    } else if (dataType == "Hashtable") {
-        HashTable<string, string> hashtable;
-        if (clusterData.contains("data")) {
-            stringstream ss(clusterData["data"].get<string>());
-            string pair;
-            while (getline(ss, pair, ',')) {
-                size_t pos = pair.find(':');
-                if (pos != string::npos) {
-                    string key = pair.substr(0, pos);
-                    string value = pair.substr(pos + 1);
-                    hashtable.insert(key, value);
-                }
-            }
-        }
-        stringstream ss(data);
-        string pair;
-        while (getline(ss, pair, ',')) {
-            size_t pos = pair.find(':');
-            if (pos != string::npos) {
-                string key = pair.substr(0, pos);
-                string value = pair.substr(pos + 1);
-                hashtable.insert(key, value);
-            }
+    // Record the addition in history
+    saveHistory(username, "Data added to cluster " + clusterName + ": " + data);
+
+    return "DATA_ADDED";
+}
+
+
+
+// Binary tree verbs; Tree is BinaryTree or the B+tree engine
+template <typename Tree>
+string analyzeBinaryTree(Tree& tree, const string& analysisType) {
+    if (analysisType == "inorder") {
+        return "Inorder traversal: " + tree.inorderAsString();
+    } else if (analysisType == "max") {
+        return "Maximum value: " + to_string(tree.findMax());
+    }
+    return "ANALYSIS_NOT_SUPPORTED_FOR_DATATYPE";
+}
+
+// AVL tree verbs; Tree is AVLTree or the B+tree engine
+template <typename Tree>
+string analyzeAVLTree(Tree& tree, const vector<string>& tokens) {
+    const string& analysisType = tokens[2];
+
+    if (analysisType == "height") {
+        return "Tree height: " + to_string(tree.getHeight());
+    } else if (analysisType == "balanced") {
+        return tree.isBalanced() ? "Tree is balanced" : "Tree is not balanced";
+    } else if (analysisType == "size") {
+        return "Tree size: " + to_string(tree.size());
+    }
+
+    // Order statistics: O(log n) lookups through the subtree counts
+    size_t count = tree.size();
+    if (analysisType == "median") {
+        if (count == 0) return "Tree is empty";
+        long long lower = tree.select((count - 1) / 2);
+        long long upper = tree.select(count / 2);
+        ostringstream median;
+        median << (lower + upper) / 2.0;
+        return "Median: " + median.str();
+    } else if (analysisType == "percentile") {
+        // Nearest-rank percentile: the smallest value with at least p% of values at or below it
+        if (tokens.size() < 4) return "INVALID_ANALYZE_FORMAT";
+        double percent;
+        try {
+            percent = stod(tokens[3]);
+        } catch (const exception&) {
+            return "INVALID_ANALYZE_FORMAT";
         }
-        clusterData["dataType"] = "Hashtable";
-        clusterData["data"] = hashtable.asString();
-    } else if (dataType == "Queue") {
-        Queue<string> queue;
-        if (clusterData.contains("data")) {
-            stringstream ss(clusterData["data"].get<string>());
-            string value;
-            while (ss >> value) queue.enqueue(value);
-        }
-        stringstream ss(data);
-        string value;
-        while (ss >> value) queue.enqueue(value);
-        clusterData["dataType"] = "Queue";
-        clusterData["data"] = queue.asString();
-    } else if (dataType == "BinaryTree") {
-        BinaryTree<int> binaryTree;
-        if (clusterData.contains("data")) {
-            stringstream ss(clusterData["data"].get<string>());
-            int value;
-            while (ss >> value) binaryTree.insert(value);
-        }
-        stringstream ss(data);
-        int value;
-        while (ss >> value) binaryTree.insert(value);
-        clusterData["dataType"] = "BinaryTree";
-        clusterData["data"] = binaryTree.inorderAsString();
-    } else if (dataType == "AVLTree") {
-        AVLTree<int> avlTree;
-        if (clusterData.contains("data")) {
-            stringstream ss(clusterData["data"].get<string>());
-            int value;
-            while (ss >> value) avlTree.insert(value);
-        }
-        stringstream ss(data);
+        if (!(percent >= 0 && percent <= 100)) return "INVALID_ANALYZE_FORMAT";
+        if (count == 0) return "Tree is empty";
+        size_t rank = static_cast<size_t>(ceil(percent / 100.0 * count));
+        return "Percentile " + tokens[3] + ": " + to_string(tree.select(rank == 0 ? 0 : rank - 1));
+    } else if (analysisType == "rank") {
+        if (tokens.size() < 4) return "INVALID_ANALYZE_FORMAT";
         int value;
-        while (ss >> value) avlTree.insert(value);
-        clusterData["dataType"] = "AVLTree";
-        clusterData["data"] = "AVLTree updated with new values";
-    } else if (dataType == "Graph") {
-        Graph<string> graph;
-        if (clusterData.contains("data")) {
-            stringstream ss(clusterData["data"].get<string>());
-            string edge;
-            while (getline(ss, edge, ',')) {
-                size_t pos = edge.find('-');
-                if (pos != string::npos) {
-                    string node1 = edge.substr(0, pos);
-                    string node2 = edge.substr(pos + 1);
-                    graph.addEdge(node1, node2);
-                }
-            }
-        }
-        stringstream ss(data);
-        string edge;
-        while (getline(ss, edge, ',')) {
-            size_t pos = edge.find('-');
-            if (pos != string::npos) {
-                string node1 = edge.substr(0, pos);
-                string node2 = edge.substr(pos + 1);
-                graph.addEdge(node1, node2);
-            }
+        try {
+            value = stoi(tokens[3]);
+        } catch (const exception&) {
+            return "INVALID_ANALYZE_FORMAT";
         }
-        clusterData["dataType"] = "Graph";
-        clusterData["data"] = "Graph updated with new edges";
-    } else if (dataType == "Heap") {
-        Heap<int> heap;
-        if (clusterData.contains("data")) {
-            stringstream ss(clusterData["data"].get<string>());
-            int value;
-            while (ss >> value) heap.insert(value);
+        return "Rank of " + to_string(value) + ": " + to_string(tree.rank(value));
+    } else if (analysisType == "select") {
+        if (tokens.size() < 4) return "INVALID_ANALYZE_FORMAT";
+        unsigned long long index;
+        try {
+            index = stoull(tokens[3]);
+        } catch (const exception&) {
+            return "INVALID_ANALYZE_FORMAT";
         }
-        stringstream ss(data);
-        int value;
-        while (ss >> value) heap.insert(value);
-        clusterData["dataType"] = "Heap";
-        clusterData["data"] = "Heap updated with new values";
-    } else {
-        return "DATA_TYPE_NOT_SUPPORTED";
+        if (tokens[3][0] == '-') return "INVALID_ANALYZE_FORMAT";
+        if (index >= count) return "INDEX_OUT_OF_RANGE";
+        return "Value at index " + to_string(index) + ": " + to_string(tree.select(index));
     }
+    return "ANALYSIS_NOT_SUPPORTED_FOR_DATATYPE";
+}
 
-    // Save updated data to persistent storage
-    saveClusterData(username, clusterName, clusterData);
+// Heap verbs; HeapType is any of the heap engines
+template <typename HeapType>
+string analyzeHeap(const HeapType& heap, const vector<string>& tokens) {
+    const string& analysisType = tokens[2];
+
+    if (analysisType == "max") {
+        return "Maximum value: " + to_string(heap.findMax());
+    } else if (analysisType == "heapify") {
+        // Each engine keeps its own layout; show the values as a binary max-heap array
+        vector<int> values = heap.toVector();
+        make_heap(values.begin(), values.end());
+        ostringstream heapified;
+        heapified << "Heapified values: [ ";
+        for (int value : values) heapified << value << " ";
+        heapified << "]";
+        return heapified.str();
+    } else if (analysisType == "topk") {
+        // The k largest values without draining the heap
+        if (tokens.size() < 4 || tokens[3][0] == '-') return "INVALID_ANALYZE_FORMAT";
+        unsigned long long k;
+        try {
+            k = stoull(tokens[3]);
+        } catch (const exception&) {
+            return "INVALID_ANALYZE_FORMAT";
+        }
+        ostringstream top;
+        top << "Top " << k << ":";
+        for (int value : heap.topK(k)) top << " " << value;
+        return top.str();
+    }
+    return "ANALYSIS_NOT_SUPPORTED_FOR_DATATYPE";
+}
 
-    // Record the addition in history
-    saveHistory(username, "Data added to cluster " + clusterName + ": " + data);
+// Page sizes for RANGE_QUERY and the graph khop verb
+const size_t DEFAULT_RANGE_LIMIT = 100;
+const size_t MAX_RANGE_LIMIT = 10000;
+
+// khop <start> <k> [limit] [cursor]: the nodes within k hops of start, nearest first (ties in
+// id order), as name:hops. Each page recomputes the depth-limited BFS and skips `cursor`
+// entries, so only the neighbourhood is walked, never the whole graph.
+string khopPage(const CsrGraph<string>& graph, const vector<string>& tokens) {
+    if (tokens.size() < 5 || tokens.size() > 7) return "INVALID_ANALYZE_FORMAT";
+    size_t hops, limit = DEFAULT_RANGE_LIMIT, cursor = 0;
+    try {
+        for (size_t i = 4; i < tokens.size(); ++i) {
+            if (tokens[i][0] == '-') return "INVALID_ANALYZE_FORMAT";
+        }
+        hops = stoull(tokens[4]);
+        if (tokens.size() > 5) limit = min<size_t>(stoull(tokens[5]), MAX_RANGE_LIMIT);
+        if (tokens.size() > 6) cursor = stoull(tokens[6]);
+    } catch (const exception&) {
+        return "INVALID_ANALYZE_FORMAT";
+    }
+    if (limit == 0) return "INVALID_ANALYZE_FORMAT";
+    uint32_t start = graph.findNode(tokens[3]);
+    if (start == CsrGraph<string>::NO_NODE) return "NODE_NOT_FOUND";
+
+    vector<size_t> levelStarts;
+    vector<uint32_t> order = graph.bfsOrder(start, &levelStarts, hops);
+    levelStarts.push_back(order.size());
+    // Levels come back in arbitrary order on large graphs; sort them so pages line up
+    for (size_t level = 1; level + 1 < levelStarts.size(); ++level) {
+        sort(order.begin() + levelStarts[level], order.begin() + levelStarts[level + 1]);
+    }
 
-    return "DATA_ADDED";
+    ostringstream response;
+    response << "Nodes:";
+    size_t begin = 1 + min(cursor, order.size() - 1);
+    size_t end = min(order.size(), begin + limit);
+    size_t level = 1;
+    for (size_t i = begin; i < end; ++i) {
+        while (i >= levelStarts[level + 1]) ++level;
+        response << " " << graph.nodeName(order[i]) << ":" << level;
+    }
+    response << "\nCursor: " << (end < order.size() ? to_string(end - 1) : "END");
+    return response.str();
 }
 
-
+// Graph verbs; bfs, reachable, path and khop name their nodes after the verb. Traversals and
+// the component pass are parallel on large graphs (see CsrGraph).
+string analyzeGraph(const CsrGraph<string>& graph, const vector<string>& tokens) {
+    const string& analysisType = tokens[2];
+
+    if (analysisType == "size") {
+        return "Graph size: " + to_string(graph.size()) + " nodes, " + to_string(graph.edgeCount()) + " edges";
+    } else if (analysisType == "connected") {
+        return graph.isConnected() ? "Graph is connected" : "Graph is not connected";
+    } else if (analysisType == "components") {
+        vector<uint32_t> labels = graph.componentLabels();
+        vector<uint32_t> sizes(labels.size(), 0);
+        size_t components = 0;
+        uint32_t largest = 0;
+        for (uint32_t id = 0; id < labels.size(); ++id) {
+            if (labels[id] == id) ++components;
+            largest = max(largest, ++sizes[labels[id]]);
+        }
+        return "Connected components: " + to_string(components) + ", largest has " + to_string(largest) + " nodes";
+    } else if (analysisType == "bfs" || analysisType == "reachable") {
+        if (tokens.size() < 4) return "INVALID_ANALYZE_FORMAT";
+        uint32_t start = graph.findNode(tokens[3]);
+        if (start == CsrGraph<string>::NO_NODE) return "NODE_NOT_FOUND";
+        vector<size_t> levelStarts;
+        vector<uint32_t> order = graph.bfsOrder(start, &levelStarts);
+        if (analysisType == "reachable") {
+            return "Reachable from " + tokens[3] + ": " + to_string(order.size()) + " nodes, farthest " +
+                   to_string(levelStarts.size() - 1) + " hops";
+        }
+        string result = "BFS traversal: ";
+        for (uint32_t id : order) result += graph.nodeName(id) + " ";
+        return result;
+    } else if (analysisType == "path") {
+        // Weighted shortest path; the nodes carry no coordinates, so A* runs with a zero heuristic
+        if (tokens.size() != 5) return "INVALID_ANALYZE_FORMAT";
+        uint32_t from = graph.findNode(tokens[3]);
+        uint32_t to = graph.findNode(tokens[4]);
+        if (from == CsrGraph<string>::NO_NODE || to == CsrGraph<string>::NO_NODE) return "NODE_NOT_FOUND";
+        vector<uint32_t> path;
+        double distance = graph.shortestPath(from, to, path);
+        if (distance == CsrGraph<string>::UNREACHABLE) return "NO_PATH";
+        string result = "Path:";
+        for (uint32_t id : path) result += " " + graph.nodeName(id);
+        return result + "\nDistance: " + CsrGraph<string>::formatWeight(distance);
+    } else if (analysisType == "khop") {
+        return khopPage(graph, tokens);
+    }
+    return "ANALYSIS_NOT_SUPPORTED_FOR_DATATYPE";
+}
 
 string handleAnalyzeData(const vector<string>& tokens, const string& username) {
     if (tokens.size() < 3) return "INVALID_ANALYZE_FORMAT";
@@ -342,25 +763,19 @@ string handleAnalyzeData(const vector<string>& tokens, const string& username) {
     string clusterName = tokens[1];
     string analysisType = tokens[2];
 
-    // Load cluster data from persistent storage
-    json clusterData = loadClusterData(username, clusterName);
-    if (clusterData.is_null()) return "CLUSTER_NOT_FOUND";
+    shared_ptr<Cluster> cluster = getCluster(username, clusterName);
+    if (!cluster) return "CLUSTER_NOT_FOUND";
 
-    string dataType = clusterData["dataType"];
-    string data = clusterData["data"];
+    shared_lock<shared_mutex> guard(cluster->lock);
+    if (cluster->deleted) return "CLUSTER_NOT_FOUND";
 
     // Circular Linked List Analysis
-    if (dataType == "CircularLinkedList") {
-        CircularLinkedList<string> linkedList;
-        stringstream ss(data);
-        string value;
-        while (ss >> value) linkedList.insert(value);
-
+    if (cluster->linkedList) {
         if (analysisType == "sort") {
             vector<string> items;
-            while (!linkedList.isEmpty()) {
-                items.push_back(linkedList.remove());
-            }
+            stringstream ss(cluster->linkedList->asString());
+            string value;
+            while (ss >> value) items.push_back(value);
             sort(items.begin(), items.end());
             return "Sorted data: " + accumulate(items.begin(), items.end(), string(""), 
                 [](const string& a, const string& b) { return a + (a.empty() ? "" : ", ") + b; });
@@ -368,32 +783,26 @@ string handleAnalyzeData(const vector<string>& tokens, const string& username) {
     }
 
     // Hashtable Analysis
-    else if (dataType == "Hashtable") {
-        HashTable<string, string> hashtable;
-        stringstream ss(data);
-        string pair;
-        while (getline(ss, pair, ',')) {
-            size_t pos = pair.find(':');
-            if (pos != string::npos) {
-                string key = pair.substr(0, pos);
-                string value = pair.substr(pos + 1);
-                hashtable.insert(key, value);
-            }
-        }
+    else if (cluster->hashtable) {
+        ConcurrentHashTable<string, string>& hashtable = *cluster->hashtable;
 
         if (analysisType == "count") {
             return "Total keys: " + to_string(hashtable.getSize());
         } else if (analysisType == "keys") {
             return "Keys: " + hashtable.asString();
+        } else if (analysisType == "stats") {
+            HashTableStats stats = hashtable.getStats();
+            ostringstream response;
+            response << "Total keys: " << stats.size << "\nCapacity: " << stats.capacity
+                     << "\nResize mode: " << (stats.mode == ResizeMode::Incremental ? "incremental" : "stop-the-world")
+                     << "\nResizes: " << stats.resizeCount << "\nPending slots: " << stats.pendingSlots;
+            return response.str();
         }
     }
 
     // Queue Analysis
-    else if (dataType == "Queue") {
-        Queue<string> queue;
-        stringstream ss(data);
-        string value;
-        while (ss >> value) queue.enqueue(value);
+    else if (cluster->queue) {
+        Queue<string>& queue = *cluster->queue;
 
         if (analysisType == "size") {
             return "Queue size: " + to_string(queue.size());
@@ -404,276 +813,231 @@ string handleAnalyzeData(const vector<string>& tokens, const string& username) {
     }
 
     // Binary Tree Analysis
-    else if (dataType == "BinaryTree") {
-        BinaryTree<int> binaryTree;
-        stringstream ss(data);
-        int value;
-        while (ss >> value) binaryTree.insert(value);
-
-        if (analysisType == "inorder") {
-            return "Inorder traversal: " + binaryTree.inorderAsString();
-        } else if (analysisType == "max") {
-            return "Maximum value: " + to_string(binaryTree.findMax());
-        }
+    else if (cluster->binaryTree) {
+        return analyzeBinaryTree(*cluster->binaryTree, analysisType);
     }
 
     // AVL Tree Analysis
-    else if (dataType == "AVLTree") {
-        AVLTree<int> avlTree;
-        stringstream ss(data);
-        int value;
-        while (ss >> value) avlTree.insert(value);
+    else if (cluster->avlTree) {
+        return analyzeAVLTree(*cluster->avlTree, tokens);
+    }
 
-        if (analysisType == "height") {
-            return "Tree height: " + to_string(avlTree.getHeight());
-        } else if (analysisType == "balanced") {
-            return avlTree.isBalanced() ? "Tree is balanced" : "Tree is not balanced";
-        }
+    // Either tree type under the B+tree engine answers the same verbs
+    else if (cluster->orderedTree) {
+        if (cluster->dataType == "AVLTree") return analyzeAVLTree(*cluster->orderedTree, tokens);
+        return analyzeBinaryTree(*cluster->orderedTree, analysisType);
     }
 
     // Graph Analysis
-    else if (dataType == "Graph") {
-        Graph<string> graph;
-        stringstream ss(data);
-        string edge;
-        while (getline(ss, edge, ',')) {
-            size_t pos = edge.find('-');
-            if (pos != string::npos) {
-                string node1 = edge.substr(0, pos);
-                string node2 = edge.substr(pos + 1);
-                graph.addEdge(node1, node2);
-            }
-        }
-
-        if (analysisType == "bfs") {
-            string startNode;
-            cout << "Enter start node for BFS: ";
-            cin >> startNode;
-            return "BFS traversal: " + graph.bfsAsString(startNode);
-        }
+    else if (cluster->graph) {
+        return analyzeGraph(*cluster->graph, tokens);
     }
 
     // Heap Analysis
-    else if (dataType == "Heap") {
-        Heap<int> heap;
-        stringstream ss(data);
-        int value;
-        while (ss >> value) heap.insert(value);
-
-        if (analysisType == "max") {
-            return "Maximum value: " + to_string(heap.findMax());
-        } else if (analysisType == "heapify") {
-            return "Heapified values: " + heap.asString();
-        }
+    else if (cluster->heap) {
+        return analyzeHeap(*cluster->heap, tokens);
+    } else if (cluster->daryHeap) {
+        return analyzeHeap(*cluster->daryHeap, tokens);
+    } else if (cluster->pairingHeap) {
+        return analyzeHeap(*cluster->pairingHeap, tokens);
     }
 
     return "ANALYSIS_NOT_SUPPORTED_FOR_DATATYPE";
 }
 
+// RANGE_QUERY <cluster> <lo> <hi> [limit] [cursor]: AVLTree values in [lo, hi], ascending, at most
+// limit of them. When more remain, the reply ends with the cursor to pass for the next page (the
+// last value sent); otherwise with "Cursor: END". Costs O(log n + limit), whatever the tree size.
+
+// One page of a range query; Tree is AVLTree or the B+tree engine
+template <typename Tree>
+string rangeQueryPage(const Tree& tree, int lo, int hi, size_t limit, bool hasCursor, int cursor) {
+    auto it = hasCursor && cursor >= lo ? tree.upperBound(cursor) : tree.lowerBound(lo);
+
+    ostringstream response;
+    response << "Values:";
+    size_t sent = 0;
+    int last = 0;
+    for (; it != tree.end() && *it <= hi && sent < limit; ++it, ++sent) {
+        last = *it;
+        response << " " << last;
+    }
+    bool more = it != tree.end() && *it <= hi;
+    response << "\nCursor: " << (more ? to_string(last) : "END");
+    return response.str();
+}
 
-string handleEditData(const vector<string>& tokens, const string& username) {
-    if (tokens.size() < 5) return "INVALID_EDIT_FORMAT";
+string handleRangeQuery(const vector<string>& tokens, const string& username) {
+    if (tokens.size() < 4 || tokens.size() > 6) return "INVALID_RANGE_QUERY_FORMAT";
 
     string clusterName = tokens[1];
-    string fileName = tokens[2]; // Not used but part of original function
-    string key = tokens[3];
-    string newValue = tokens[4];
-
-    // Load cluster data from persistent storage
-    json clusterData = loadClusterData(username, clusterName);
-    if (clusterData.is_null()) {
-        return "CLUSTER_NOT_FOUND";
+    int lo, hi, cursor = 0;
+    size_t limit = DEFAULT_RANGE_LIMIT;
+    bool hasCursor = tokens.size() == 6;
+    try {
+        lo = stoi(tokens[2]);
+        hi = stoi(tokens[3]);
+        if (tokens.size() >= 5) {
+            if (tokens[4][0] == '-') return "INVALID_RANGE_QUERY_FORMAT";
+            limit = min<size_t>(stoul(tokens[4]), MAX_RANGE_LIMIT);
+        }
+        if (hasCursor) cursor = stoi(tokens[5]);
+    } catch (const exception&) {
+        return "INVALID_RANGE_QUERY_FORMAT";
     }
+    if (limit == 0) return "INVALID_RANGE_QUERY_FORMAT";
 
-    string dataType = clusterData["dataType"];
-
-    // Editing for Hashtable
-    if (dataType == "Hashtable") {
-        HashTable<string, string> hashtable;
-        stringstream ss(clusterData["data"].get<string>());
-        string pair;
-        while (getline(ss, pair, ',')) {
-            size_t pos = pair.find(':');
-            if (pos != string::npos) {
-                string currentKey = pair.substr(0, pos);
-                string value = pair.substr(pos + 1);
-                hashtable.insert(currentKey, value);
-            }
-        }
+    shared_ptr<Cluster> cluster = getCluster(username, clusterName);
+    if (!cluster) return "CLUSTER_NOT_FOUND";
 
-        if (hashtable.contains(key)) {
-            hashtable.insert(key, newValue);
-            clusterData["data"] = hashtable.asString();
-            saveClusterData(username, clusterName, clusterData);
-            saveHistory(username, "Edited key " + key + " in cluster " + clusterName);
-            return "DATA_EDITED";
-        } else {
-            return "KEY_NOT_FOUND";
-        }
-    }
-
-    // Editing for CircularLinkedList
-    else if (dataType == "CircularLinkedList") {
-        CircularLinkedList<string> linkedList;
-        stringstream ss(clusterData["data"].get<string>());
-        string value;
-        while (ss >> value) linkedList.insert(value);
-
-        // Find and replace the element (Linked List doesn't have key-value pair)
-        bool found = false;
-        while (!linkedList.isEmpty()) {
-            string current = linkedList.remove();
-            if (current == key) {
-                linkedList.insert(newValue);
-                found = true;
-            } else {
-                linkedList.insert(current);  // Insert back if not modified
-            }
-        }
+    shared_lock<shared_mutex> guard(cluster->lock);
+    if (cluster->deleted) return "CLUSTER_NOT_FOUND";
+    if (cluster->avlTree) return rangeQueryPage(*cluster->avlTree, lo, hi, limit, hasCursor, cursor);
+    if (cluster->orderedTree && cluster->dataType == "AVLTree") {
+        return rangeQueryPage(*cluster->orderedTree, lo, hi, limit, hasCursor, cursor);
+    }
+    return "RANGE_QUERY_NOT_SUPPORTED_FOR_DATATYPE";
+}
 
-        if (found) {
-            clusterData["data"] = linkedList.asString();
-            saveClusterData(username, clusterName, clusterData);
-            saveHistory(username, "Edited value in CircularLinkedList in cluster " + clusterName);
-            return "DATA_EDITED";
-        } else {
-            return "KEY_NOT_FOUND";
-        }
-    }
-
-    // Editing for Queue
-    else if (dataType == "Queue") {
-        Queue<string> queue;
-        stringstream ss(clusterData["data"].get<string>());
-        string value;
-        while (ss >> value) queue.enqueue(value);
-
-        // Find and replace the element (Queue operates on a first-in-first-out basis)
-        bool found = false;
-        size_t size = queue.size();
-        for (size_t i = 0; i < size; i++) {
-            string current = queue.dequeue();
-            if (current == key) {
-                queue.enqueue(newValue);
-                found = true;
-            } else {
-                queue.enqueue(current);
-            }
+// DEQUEUE <cluster> [timeoutMs] takes the front value of a Queue cluster; DEQUEUE_BATCH <cluster>
+// <max> [timeoutMs] takes up to max of them. With a timeout, a connection that finds the queue
+// empty is parked (see Client Handling) until ADD_DATA brings values or the timeout passes.
+const size_t MAX_DEQUEUE_BATCH = 10000;
+const long long MAX_DEQUEUE_TIMEOUT_MS = 5 * 60 * 1000;
+
+struct DequeueRequest {
+    string username;
+    string clusterName;
+    size_t max = 1;
+    bool batch = false; // DEQUEUE_BATCH replies "Values: ...", DEQUEUE "Value: ..."
+    chrono::milliseconds timeout{0};
+};
+
+// Fill request from the tokens; returns an error code, or "" when they are valid
+string parseDequeue(const vector<string>& tokens, const string& username, DequeueRequest& request) {
+    request.batch = tokens[0] == "DEQUEUE_BATCH";
+    size_t timeoutIndex = request.batch ? 3 : 2;
+    if (tokens.size() < timeoutIndex || tokens.size() > timeoutIndex + 1) return "INVALID_DEQUEUE_FORMAT";
+
+    request.username = username;
+    request.clusterName = tokens[1];
+    try {
+        if (request.batch) {
+            if (tokens[2][0] == '-') return "INVALID_DEQUEUE_FORMAT";
+            request.max = min<size_t>(stoul(tokens[2]), MAX_DEQUEUE_BATCH);
         }
-
-        if (found) {
-            clusterData["data"] = queue.asString();
-            saveClusterData(username, clusterName, clusterData);
-            saveHistory(username, "Edited value in Queue in cluster " + clusterName);
-            return "DATA_EDITED";
-        } else {
-            return "KEY_NOT_FOUND";
+        if (tokens.size() > timeoutIndex) {
+            long long millis = stoll(tokens[timeoutIndex]);
+            if (millis < 0) return "INVALID_DEQUEUE_FORMAT";
+            request.timeout = chrono::milliseconds(min(millis, MAX_DEQUEUE_TIMEOUT_MS));
         }
+    } catch (const exception&) {
+        return "INVALID_DEQUEUE_FORMAT";
     }
+    if (request.max == 0) return "INVALID_DEQUEUE_FORMAT";
+    return "";
+}
 
-    // Editing for BinaryTree
-    else if (dataType == "BinaryTree") {
-        BinaryTree<int> binaryTree;
-        stringstream ss(clusterData["data"].get<string>());
-        int value;
-        while (ss >> value) binaryTree.insert(value);
-
-        // Find and replace the value in the BinaryTree
-        // Here we assume the tree doesn't support direct key modification, so we remove and reinsert
-        binaryTree.remove(stoi(key)); // Assuming 'key' is the value to be removed
-        binaryTree.insert(stoi(newValue));
-
-        clusterData["data"] = binaryTree.inorderAsString();
-        saveClusterData(username, clusterName, clusterData);
-        saveHistory(username, "Edited value in BinaryTree in cluster " + clusterName);
-        return "DATA_EDITED";
+// Take up to request.max values from the front of the queue and log the removal. If the queue is
+// empty, park runs under the cluster lock, so no ADD_DATA can land between the check and the
+// parking. Returns false when park took the request, in which case there is no response yet.
+bool takeFromQueue(const DequeueRequest& request, string& response, const function<bool()>& park) {
+    shared_ptr<Cluster> cluster = getCluster(request.username, request.clusterName);
+    if (!cluster) {
+        response = "CLUSTER_NOT_FOUND";
+        return true;
     }
 
-    // Editing for AVLTree
-    else if (dataType == "AVLTree") {
-        AVLTree<int> avlTree;
-        stringstream ss(clusterData["data"].get<string>());
-        int value;
-        while (ss >> value) avlTree.insert(value);
-
-        // Find and replace the value in the AVLTree
-        avlTree.remove(stoi(key)); // Assuming 'key' is the value to be removed
-        avlTree.insert(stoi(newValue));
-
-        clusterData["data"] = "AVLTree updated with new value";
-        saveClusterData(username, clusterName, clusterData);
-        saveHistory(username, "Edited value in AVLTree in cluster " + clusterName);
-        return "DATA_EDITED";
-    }
-
-    // Editing for Graph
-    else if (dataType == "Graph") {
-        Graph<string> graph;
-        stringstream ss(clusterData["data"].get<string>());
-        string edge;
-        while (getline(ss, edge, ',')) {
-            size_t pos = edge.find('-');
-            if (pos != string::npos) {
-                string node1 = edge.substr(0, pos);
-                string node2 = edge.substr(pos + 1);
-                graph.addEdge(node1, node2);
-            }
+    uint64_t lsn;
+    vector<string> values;
+    {
+        lock_guard<shared_mutex> guard(cluster->lock);
+        if (cluster->deleted) {
+            response = "CLUSTER_NOT_FOUND";
+            return true;
         }
-
-        // Find and replace the edge in the Graph (if applicable)
-        bool found = false;
-        stringstream newEdges;
-        while (getline(ss, edge, ',')) {
-            size_t pos = edge.find('-');
-            if (pos != string::npos) {
-                string node1 = edge.substr(0, pos);
-                string node2 = edge.substr(pos + 1);
-                if (node1 == key || node2 == key) {
-                    newEdges << node1 << "-" << newValue << ",";
-                    found = true;
-                } else {
-                    newEdges << edge << ",";
-                }
-            }
+        // A cluster with no data type yet may still become a queue, so it can be waited on
+        if (!cluster->dataType.empty() && !cluster->queue) {
+            response = "DEQUEUE_NOT_SUPPORTED_FOR_DATATYPE";
+            return true;
         }
-
-        if (found) {
-            clusterData["data"] = newEdges.str();
-            saveClusterData(username, clusterName, clusterData);
-            saveHistory(username, "Edited edge in Graph in cluster " + clusterName);
-            return "DATA_EDITED";
-        } else {
-            return "KEY_NOT_FOUND";
+        if (!cluster->queue || cluster->queue->isEmpty()) {
+            if (park && park()) return false;
+            response = "QUEUE_EMPTY";
+            return true;
         }
+        if (!writeAheadLog.healthy()) {
+            response = "WRITE_FAILED";
+            return true;
+        }
+        values = cluster->queue->dequeueBatch(request.max);
+        lsn = writeAheadLog.append({"DEQUEUE", request.username, request.clusterName, to_string(values.size())});
+        cluster->lsn = lsn;
+        cluster->dirty = true;
+    }
+    if (!writeAheadLog.waitDurable(lsn)) {
+        // The removal never reached the log, so the values go back where they were
+        {
+            lock_guard<shared_mutex> guard(cluster->lock);
+            if (!cluster->deleted && cluster->queue) cluster->queue->enqueueFront(values);
+        }
+        wakeDequeueWaiters(request.username, request.clusterName);
+        response = "WRITE_FAILED";
+        return true;
     }
 
-    // Editing for Heap
-    else if (dataType == "Heap") {
-        Heap<int> heap;
-        stringstream ss(clusterData["data"].get<string>());
-        int value;
-        while (ss >> value) heap.insert(value);
+    ostringstream reply;
+    reply << (request.batch ? "Values:" : "Value:");
+    for (const auto& value : values) reply << " " << value;
+    response = reply.str();
+    return true;
+}
 
-        // Find and replace the value in the Heap
-        heap.remove(stoi(key));  // Assuming 'key' is the value to be removed
-        heap.insert(stoi(newValue));
+string handleEditData(const vector<string>& tokens, const string& username) {
+    if (tokens.size() < 5) return "INVALID_EDIT_FORMAT";
+
+    string clusterName = tokens[1];
+    string fileName = tokens[2]; // Not used but part of original function
+    string key = tokens[3];
+    string newValue = tokens[4];
+
+    shared_ptr<Cluster> cluster = getCluster(username, clusterName);
+    if (!cluster) {
+        return "CLUSTER_NOT_FOUND";
+    }
 
-        clusterData["data"] = "Heap updated with new value";
-        saveClusterData(username, clusterName, clusterData);
-        saveHistory(username, "Edited value in Heap in cluster " + clusterName);
-        return "DATA_EDITED";
+    uint64_t lsn;
+    string dataType;
+    {
+        ClusterWriteGuard guard(*cluster);
+        if (cluster->deleted) return "CLUSTER_NOT_FOUND";
+        if (!isSupportedDataType(cluster->dataType)) return "EDIT_OPERATION_NOT_SUPPORTED_FOR_DATATYPE";
+        if (!writeAheadLog.healthy()) return "WRITE_FAILED";
+        if (!editClusterData(*cluster, key, newValue)) return "KEY_NOT_FOUND";
+
+        lsn = writeAheadLog.append({"EDIT_DATA", username, clusterName, key, newValue});
+        cluster->lsn = lsn;
+        cluster->dirty = true;
+        dataType = cluster->dataType;
     }
+    if (!writeAheadLog.waitDurable(lsn)) return "WRITE_FAILED";
 
-    return "EDIT_OPERATION_NOT_SUPPORTED_FOR_DATATYPE";
+    if (dataType == "Hashtable") {
+        saveHistory(username, "Edited key " + key + " in cluster " + clusterName);
+    } else if (dataType == "Graph") {
+        saveHistory(username, "Edited edge in Graph in cluster " + clusterName);
+    } else {
+        saveHistory(username, "Edited value in " + dataType + " in cluster " + clusterName);
+    }
+    return "DATA_EDITED";
 }
 
 string handleCheckCluster(const vector<string>& tokens, const string& username) {
     if (tokens.size() != 2) return "INVALID_CHECK_CLUSTER_FORMAT";
 
     string clusterName = tokens[1];
-    string clusterPath = getClusterFilePath(username, clusterName);
 
-    if (fs::exists(clusterPath)) {
+    if (clusterCatalog.contains(username, clusterName)) {
         return "CLUSTER_FOUND";
     }
 
@@ -695,20 +1059,27 @@ string handleDeleteData(const vector<string>& tokens, const string& username) {
     string password = tokens[3];
 
     // Verify password
-    json userData = loadUserCredentials();
-    if (!userData.contains(username) || userData[username] != password) {
+    if (!userStore.verify(username, password)) {
         return "INVALID_PASSWORD";
     }
 
-    // Load cluster data
-    json clusterData = loadClusterData(username, clusterName);
-    if (clusterData.is_null()) {
+    shared_ptr<Cluster> cluster = getCluster(username, clusterName);
+    if (!cluster) {
         return "CLUSTER_NOT_FOUND";
     }
 
     // Clear data
-    clusterData["data"] = "";
-    saveClusterData(username, clusterName, clusterData);
+    uint64_t lsn;
+    {
+        ClusterWriteGuard guard(*cluster);
+        if (cluster->deleted) return "CLUSTER_NOT_FOUND";
+        if (!writeAheadLog.healthy()) return "WRITE_FAILED";
+        clearClusterData(*cluster);
+        lsn = writeAheadLog.append({"DELETE_DATA", username, clusterName});
+        cluster->lsn = lsn;
+        cluster->dirty = true;
+    }
+    if (!writeAheadLog.waitDurable(lsn)) return "WRITE_FAILED";
 
     saveHistory(username, "Data deleted from cluster " + clusterName);
 
@@ -716,12 +1087,19 @@ string handleDeleteData(const vector<string>& tokens, const string& username) {
 }
 string handleClientQuery(const string& query, const string& clientIP) {
     cout << "DEBUG: Received query: " << query << endl;
-    stringstream ss(query);
-    string command;
+    TokenCursor cursor(query);
     vector<string> tokens;
 
     // Tokenize the input query
-    while (ss >> command) tokens.push_back(command);
+    for (string_view token = cursor.next(); !token.empty(); token = cursor.next()) {
+        tokens.emplace_back(token);
+        // ADD_DATA carries a free-form payload: keep everything after the data type as one token
+        if (tokens.size() == 3 && tokens[0] == "ADD_DATA") {
+            string_view payload = cursor.rest();
+            if (!payload.empty()) tokens.emplace_back(payload);
+            break;
+        }
+    }
     if (tokens.empty()) return "EMPTY_QUERY";
 
     // Extract username (if available)
@@ -744,7 +1122,7 @@ string handleClientQuery(const string& query, const string& clientIP) {
     return handleRegister(tokens);
 }
     else if (tokens[0] == "DELETE_CLUSTER") {
-        if (tokens.size() < 3) return "INVALID_DELETE_CLUSTER_FORMAT";
+        if (tokens.size() < 2) return "INVALID_DELETE_CLUSTER_FORMAT";
         return handleDeleteCluster(tokens, username);
     } 
     else if (tokens[0] == "LIST_CLUSTERS") {
@@ -775,44 +1153,336 @@ else if (tokens[0] == "DELETE_DATA") {
         if (tokens.size() < 3) return "INVALID_ANALYZE_DATA_FORMAT";
         return handleAnalyzeData(tokens, username);
     } 
+    else if (tokens[0] == "RANGE_QUERY") {
+        if (tokens.size() < 4) return "INVALID_RANGE_QUERY_FORMAT";
+        return handleRangeQuery(tokens, username);
+    }
+    // DEQUEUE and DEQUEUE_BATCH may park the connection, so the client handling routes them
 
     return "UNKNOWN_COMMAND";
 }
 
 
 // **Client Handling**
-void handleClient(int clientSocket) {
-    char buffer[1024] = {0};
-    sockaddr_in clientAddr;
-    socklen_t addrLen = sizeof(clientAddr);
-    getpeername(clientSocket, (struct sockaddr*)&clientAddr, &addrLen);
-    string clientIP = inet_ntoa(clientAddr.sin_addr);
+const int SERVER_PORT = 8080;
+const int MAX_EVENTS = 256;
+const int READS_PER_EVENT = 16; // Bound the work one connection gets before yielding its worker
+const size_t READ_CHUNK_SIZE = 64 * 1024;
+
+struct Connection {
+    int socket;
+    string clientIP;
+    FrameParser parser; // Requests received but not yet executed
+    string outBuffer;   // Framed responses not yet accepted by the kernel
+};
+
+int epollFd = -1;
+int wakeupFd = -1;                // eventfd that interrupts epoll_wait when timers change
+ThreadPool* workerPool = nullptr; // Runs client work, including connections resumed off the event loop
+
+bool setNonBlocking(int sock) {
+    int flags = fcntl(sock, F_GETFL, 0);
+    return flags != -1 && fcntl(sock, F_SETFL, flags | O_NONBLOCK) != -1;
+}
 
-    while (true) {
-        memset(buffer, 0, 1024);
-        int bytesReceived = recv(clientSocket, buffer, 1024, 0);
-        if (bytesReceived <= 0) break;
+void closeConnection(Connection* conn) {
+    epoll_ctl(epollFd, EPOLL_CTL_DEL, conn->socket, nullptr);
+    close(conn->socket);
+    delete conn;
+}
+
+// Re-enable readiness notifications once a worker is done with the connection
+void rearmConnection(Connection* conn) {
+    epoll_event event = {};
+    event.events = EPOLLIN | EPOLLRDHUP | EPOLLONESHOT;
+    if (!conn->outBuffer.empty()) event.events |= EPOLLOUT;
+    event.data.ptr = conn;
+    epoll_ctl(epollFd, EPOLL_CTL_MOD, conn->socket, &event);
+}
+
+// Push as much of the pending output as the socket accepts; false on a dead peer
+bool flushConnection(Connection* conn) {
+    size_t sent = 0;
+    while (sent < conn->outBuffer.size()) {
+        ssize_t n = send(conn->socket, conn->outBuffer.data() + sent, conn->outBuffer.size() - sent, MSG_NOSIGNAL);
+        if (n > 0) {
+            sent += n;
+        } else if (n < 0 && errno == EINTR) {
+            continue;
+        } else if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+            break;
+        } else {
+            return false;
+        }
+    }
+    conn->outBuffer.erase(0, sent);
+    return true;
+}
+
+/// **Blocking dequeue**
+
+// A connection parked on DEQUEUE. It is not armed in epoll while parked, so no worker and no
+// thread is tied to it; whoever claims the waiter from the registry owns the connection again.
+struct DequeueWaiter {
+    Connection* conn;
+    DequeueRequest request;
+    chrono::steady_clock::time_point deadline;
+};
+
+// Parked connections, FIFO per cluster and ordered by deadline for the event loop's timer
+class DequeueWaiters {
+private:
+    mutex lock;
+    unordered_map<string, deque<DequeueWaiter*>> byCluster;
+    set<pair<chrono::steady_clock::time_point, DequeueWaiter*>> byDeadline;
+
+    static string key(const string& username, const string& clusterName) {
+        return username + '\0' + clusterName;
+    }
+
+    void unlinkFromCluster(DequeueWaiter* waiter) {
+        auto it = byCluster.find(key(waiter->request.username, waiter->request.clusterName));
+        it->second.erase(find(it->second.begin(), it->second.end(), waiter));
+        if (it->second.empty()) byCluster.erase(it);
+    }
+
+public:
+    // Returns true if the waiter now has the earliest deadline, so the event loop must re-time
+    bool park(DequeueWaiter* waiter, bool atFront) {
+        lock_guard<mutex> guard(lock);
+        auto& queue = byCluster[key(waiter->request.username, waiter->request.clusterName)];
+        if (atFront) queue.push_front(waiter);
+        else queue.push_back(waiter);
+        byDeadline.insert({waiter->deadline, waiter});
+        return byDeadline.begin()->second == waiter;
+    }
 
-        string query(buffer);
-        cout << "Received query: " << query << " from " << clientIP << endl;
+    // The longest-waiting connection on the cluster, or nullptr
+    DequeueWaiter* claimFirst(const string& username, const string& clusterName) {
+        lock_guard<mutex> guard(lock);
+        auto it = byCluster.find(key(username, clusterName));
+        if (it == byCluster.end()) return nullptr;
+        DequeueWaiter* waiter = it->second.front();
+        it->second.pop_front();
+        if (it->second.empty()) byCluster.erase(it);
+        byDeadline.erase({waiter->deadline, waiter});
+        return waiter;
+    }
+
+    vector<DequeueWaiter*> claimExpired(chrono::steady_clock::time_point now) {
+        lock_guard<mutex> guard(lock);
+        vector<DequeueWaiter*> expired;
+        while (!byDeadline.empty() && byDeadline.begin()->first <= now) {
+            DequeueWaiter* waiter = byDeadline.begin()->second;
+            byDeadline.erase(byDeadline.begin());
+            unlinkFromCluster(waiter);
+            expired.push_back(waiter);
+        }
+        return expired;
+    }
+
+    // epoll_wait timeout until the next deadline, rounded up; -1 when nobody is waiting
+    int millisUntilNextDeadline(chrono::steady_clock::time_point now) {
+        lock_guard<mutex> guard(lock);
+        if (byDeadline.empty()) return -1;
+        auto remaining = byDeadline.begin()->first - now;
+        if (remaining <= chrono::steady_clock::duration::zero()) return 0;
+        return static_cast<int>(chrono::ceil<chrono::milliseconds>(remaining).count());
+    }
+};
+
+DequeueWaiters dequeueWaiters;
+
+void nudgeEventLoop() {
+    uint64_t one = 1;
+    ssize_t ignored = write(wakeupFd, &one, sizeof(one));
+    (void)ignored;
+}
+
+void resumeConnection(Connection* conn);
+
+// Try to serve a waiter that was just claimed; if another consumer emptied the queue first,
+// it goes back to the front of the line with its original deadline
+void serveDequeueWaiter(DequeueWaiter* waiter) {
+    string response;
+    bool served = takeFromQueue(waiter->request, response, [waiter] {
+        if (dequeueWaiters.park(waiter, true)) nudgeEventLoop();
+        return true;
+    });
+    if (!served) return;
+
+    Connection* conn = waiter->conn;
+    DequeueRequest request = waiter->request;
+    delete waiter;
+    appendFrame(conn->outBuffer, response);
+    resumeConnection(conn);
+    // Values may remain for the next waiter in line
+    wakeDequeueWaiters(request.username, request.clusterName);
+}
+
+void wakeDequeueWaiters(const string& username, const string& clusterName) {
+    DequeueWaiter* waiter = dequeueWaiters.claimFirst(username, clusterName);
+    if (waiter) workerPool->submit([waiter] { serveDequeueWaiter(waiter); });
+}
+
+// Answer every waiter whose timeout passed; runs on the event loop
+void expireDequeueWaiters() {
+    for (DequeueWaiter* waiter : dequeueWaiters.claimExpired(chrono::steady_clock::now())) {
+        Connection* conn = waiter->conn;
+        delete waiter;
+        workerPool->submit([conn] {
+            appendFrame(conn->outBuffer, "QUEUE_EMPTY");
+            resumeConnection(conn);
+        });
+    }
+}
+
+// DEQUEUE or DEQUEUE_BATCH as the first token
+bool isDequeueQuery(const string& query) {
+    size_t start = query.find_first_not_of(" \t\r\n");
+    if (start == string::npos || query.compare(start, 7, "DEQUEUE") != 0) return false;
+    size_t end = query.find_first_of(" \t\r\n", start);
+    size_t length = (end == string::npos ? query.size() : end) - start;
+    return length == 7 || (length == 13 && query.compare(start, 13, "DEQUEUE_BATCH") == 0);
+}
 
-        string response = handleClientQuery(query, clientIP);
-        send(clientSocket, response.c_str(), response.size(), 0);
+// Execute a DEQUEUE frame. Returns false if the connection was parked instead of answered.
+bool executeDequeue(Connection* conn, const string& query, string& response) {
+    TokenCursor cursor(query);
+    vector<string> tokens;
+    for (string_view token = cursor.next(); !token.empty(); token = cursor.next()) tokens.emplace_back(token);
+    if (tokens.size() < 2) {
+        response = "INVALID_DEQUEUE_FORMAT";
+        return true;
+    }
+
+    DequeueRequest request;
+    response = parseDequeue(tokens, tokens[1], request);
+    if (!response.empty()) return true;
+    if (request.timeout.count() == 0) return takeFromQueue(request, response, nullptr);
+
+    // Responses to earlier pipelined frames must not sit in the buffer for the whole wait
+    flushConnection(conn);
+    auto deadline = chrono::steady_clock::now() + request.timeout;
+    return takeFromQueue(request, response, [conn, &request, deadline] {
+        if (dequeueWaiters.park(new DequeueWaiter{conn, request, deadline}, false)) nudgeEventLoop();
+        return true;
+    });
+}
+
+/// **Connection processing**
+
+// Execute every complete buffered frame in arrival order, so pipelined requests get in-order
+// responses. Returns false if a DEQUEUE parked the connection; the caller must then leave it
+// alone, and whoever unparks it calls resumeConnection to carry on from the next frame.
+bool runQueries(Connection* conn) {
+    string query;
+    while (conn->parser.next(query)) {
+        cout << "Received query: " << query << " from " << conn->clientIP << endl;
+        string response;
+        if (isDequeueQuery(query)) {
+            if (!executeDequeue(conn, query, response)) return false;
+        } else {
+            response = handleClientQuery(query, conn->clientIP);
+        }
+        appendFrame(conn->outBuffer, response);
+    }
+    return true;
+}
+
+// Continue a connection that was parked: run what it had already sent, then listen again
+void resumeConnection(Connection* conn) {
+    if (!runQueries(conn)) return;
+    if (!flushConnection(conn)) {
+        closeConnection(conn);
+        return;
     }
+    rearmConnection(conn);
+}
 
-    close(clientSocket);
+// Runs on a pool worker; EPOLLONESHOT guarantees no other worker owns conn meanwhile.
+void handleClient(Connection* conn) {
+    bool peerClosed = false;
+
+    for (int i = 0; i < READS_PER_EVENT; ++i) {
+        ssize_t bytesReceived = recv(conn->socket, conn->parser.prepare(READ_CHUNK_SIZE), READ_CHUNK_SIZE, 0);
+        if (bytesReceived < 0 && errno == EINTR) continue;
+        if (bytesReceived < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) break;
+        if (bytesReceived <= 0) {
+            peerClosed = true;
+            break;
+        }
+        conn->parser.commit(bytesReceived);
+
+        if (!runQueries(conn)) return; // Parked: the connection now belongs to dequeueWaiters
+        if (conn->parser.hasError()) {
+            cerr << "Oversized frame from " << conn->clientIP << ", closing connection.\n";
+            closeConnection(conn);
+            return;
+        }
+    }
+
+    if (!flushConnection(conn) || (peerClosed && conn->outBuffer.empty())) {
+        closeConnection(conn);
+        return;
+    }
+    rearmConnection(conn);
+}
+
+void acceptClients(int serverSock) {
+    while (true) {
+        sockaddr_in clientAddr;
+        socklen_t clientLen = sizeof(clientAddr);
+        int clientSock = accept(serverSock, (struct sockaddr*)&clientAddr, &clientLen);
+        if (clientSock < 0) {
+            if (errno == EINTR) continue;
+            if (errno != EAGAIN && errno != EWOULDBLOCK) cerr << "Failed to accept client connection.\n";
+            return;
+        }
+        if (!setNonBlocking(clientSock)) {
+            close(clientSock);
+            continue;
+        }
+
+        Connection* conn = new Connection();
+        conn->socket = clientSock;
+        conn->clientIP = inet_ntoa(clientAddr.sin_addr);
+        epoll_event event = {};
+        event.events = EPOLLIN | EPOLLRDHUP | EPOLLONESHOT;
+        event.data.ptr = conn;
+        if (epoll_ctl(epollFd, EPOLL_CTL_ADD, clientSock, &event) < 0) {
+            close(clientSock);
+            delete conn;
+            continue;
+        }
+        cout << "Client connected.\n";
+    }
+}
+
+// Allow as many sockets as the hard limit permits so idle clients don't exhaust descriptors
+void raiseDescriptorLimit() {
+    rlimit limit;
+    if (getrlimit(RLIMIT_NOFILE, &limit) == 0 && limit.rlim_cur < limit.rlim_max) {
+        limit.rlim_cur = limit.rlim_max;
+        setrlimit(RLIMIT_NOFILE, &limit);
+    }
 }
 
 int main() {
+    raiseDescriptorLimit();
+
     int serverSock = socket(AF_INET, SOCK_STREAM, 0);
     if (serverSock == -1) {
         cerr << "Socket creation failed.\n";
         return 1;
     }
 
+    int reuse = 1;
+    setsockopt(serverSock, SOL_SOCKET, SO_REUSEADDR, &reuse, sizeof(reuse));
+
     sockaddr_in serverAddr = {};
     serverAddr.sin_family = AF_INET;
-    serverAddr.sin_port = htons(8080);
+    serverAddr.sin_port = htons(SERVER_PORT);
     serverAddr.sin_addr.s_addr = INADDR_ANY;
 
     if (bind(serverSock, (struct sockaddr*)&serverAddr, sizeof(serverAddr)) < 0) {
@@ -820,27 +1490,65 @@ int main() {
         return 1;
     }
 
-    if (listen(serverSock, 5) < 0) {
+    if (listen(serverSock, SOMAXCONN) < 0 || !setNonBlocking(serverSock)) {
         cerr << "Listening failed.\n";
         return 1;
     }
 
-    cout << "Server is listening on port 8080...\n";
+    epollFd = epoll_create1(0);
+    if (epollFd < 0) {
+        cerr << "Event loop creation failed.\n";
+        return 1;
+    }
+
+    epoll_event listenEvent = {};
+    listenEvent.events = EPOLLIN;
+    listenEvent.data.ptr = nullptr; // nullptr marks the listening socket
+    epoll_ctl(epollFd, EPOLL_CTL_ADD, serverSock, &listenEvent);
+
+    wakeupFd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    epoll_event wakeupEvent = {};
+    wakeupEvent.events = EPOLLIN;
+    wakeupEvent.data.ptr = &wakeupFd; // Marks the timer nudge
+    epoll_ctl(epollFd, EPOLL_CTL_ADD, wakeupFd, &wakeupEvent);
 
+    loadUsers();
+    recoverClusters();
+    thread(checkpointLoop).detach();
+
+    ThreadPool workers;
+    workerPool = &workers;
+    cout << "Server is listening on port " << SERVER_PORT << " with " << workers.getThreadCount() << " workers...\n";
+
+    epoll_event events[MAX_EVENTS];
     while (true) {
-        sockaddr_in clientAddr;
-        socklen_t clientLen = sizeof(clientAddr);
-        int clientSock = accept(serverSock, (struct sockaddr*)&clientAddr, &clientLen);
-        if (clientSock < 0) {
-            cerr << "Failed to accept client connection.\n";
-            continue;
+        // Sleep no longer than the nearest DEQUEUE timeout
+        int timeout = dequeueWaiters.millisUntilNextDeadline(chrono::steady_clock::now());
+        int ready = epoll_wait(epollFd, events, MAX_EVENTS, timeout);
+        if (ready < 0) {
+            if (errno == EINTR) continue;
+            cerr << "Event loop failed.\n";
+            break;
         }
+        expireDequeueWaiters();
 
-        cout << "Client connected.\n";
-        thread(handleClient, clientSock).detach();
+        for (int i = 0; i < ready; ++i) {
+            if (!events[i].data.ptr) {
+                acceptClients(serverSock);
+                continue;
+            }
+            if (events[i].data.ptr == &wakeupFd) {
+                uint64_t count;
+                ssize_t ignored = read(wakeupFd, &count, sizeof(count));
+                (void)ignored;
+                continue;
+            }
+            Connection* conn = static_cast<Connection*>(events[i].data.ptr);
+            workers.submit([conn] { handleClient(conn); });
+        }
     }
 
+    close(epollFd);
     close(serverSock);
     return 0;
 }
-